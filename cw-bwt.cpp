@@ -86,6 +86,13 @@ using namespace std;
 	 * However, this requires more space in RAM since the string bwt is kept in memory together with the structures of cwbwt
 	 * WARNING: if you directly print cwbwt.toString(), you won't see the terminator character since it is a 0x0 byte.
 	 *
+	 * To index the bwt, load it directly in a dynamic BWT or FM-index (include "dynamic/dynamic.hpp"):
+	 *
+	 * dyn::rle_fmi idx;
+	 * cwbwt.toBWT(idx);
+	 *
+	 * The runs of the bwt are streamed into the structure: the uncompressed bwt is never kept in RAM.
+	 *
 	 */
 
 	//printRSSstat(cwbwt.length());
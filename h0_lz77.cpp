@@ -25,6 +25,10 @@ using namespace dyn;
 
 ulint sa_rate = 0;
 bool int_file = false;
+lz77_coding coding = lz77_coding::raw;
+ulint checkpoint_rate = 0;
+bool resume = false;
+ulint window = 0;
 
 void help(){
 
@@ -33,6 +37,10 @@ cout << "Build LZ77 using a zero-order compressed FM index." << endl << endl;
 		cout << "Options: " << endl;
 		cout << "-s <sample_rate>   store one SA sample every sample_rate positions. default: 256." << endl;
 		cout << "-i                 Interpret the file as a stream of 32-bits integers." << endl;
+		cout << "-c <coding>        output coding: raw, varint, gamma or delta (see lz77_format.hpp). default: raw." << endl;
+		cout << "-t <chars>         save a checkpoint to <output_file>.ckpt every <chars> input characters. default: no checkpoints." << endl;
+		cout << "-r                 resume from the checkpoint <output_file>.ckpt (use the same options and files of the interrupted run)." << endl;
+		cout << "-w <chars>         index only the last <chars> input characters (sliding window): phrases copy from the window and memory stays bounded. default: whole input." << endl;
 		cout << "input_file: file to be parsed" << endl;
 		cout << "output_file: LZ77 triples <start,length,trailing_character> will be saved in binary format in this file" << endl << endl;
 		cout << "Note: the file should terminate with a character (or int if -i) not appearing elsewhere." << endl;
@@ -57,6 +65,25 @@ void parse_args(char** argv, int argc, int &ptr){
 
 		int_file = true;
 
+	}else if(s.compare("-c")==0){
+
+		if(not lz77_coding_from_string(argv[ptr++], coding)){
+			cout << "Error: unknown coding '" << argv[ptr-1] << "'." << endl;
+			help();
+		}
+
+	}else if(s.compare("-t")==0 and ptr<argc){
+
+		checkpoint_rate = atol(argv[ptr++]);
+
+	}else if(s.compare("-r")==0){
+
+		resume = true;
+
+	}else if(s.compare("-w")==0 and ptr<argc){
+
+		window = atol(argv[ptr++]);
+
 	}else{
 		cout << "Error: unrecognized '" << s << "' option." << endl;
 		help();
@@ -97,29 +124,62 @@ int main(int argc,char** argv) {
 
 	cout << "Sample rate is " << sa_rate << endl;
 
+	string ckpt = out + ".ckpt";
+
+	if(resume and not std::ifstream(ckpt)){
+		cout << "Error: checkpoint " << ckpt << " not found." << endl;
+		exit(1);
+	}
+
+	//when resuming, the output written before the checkpoint is kept
+	auto out_mode = resume ? ios::binary | ios::in | ios::out : ios::binary;
+
 	if(not int_file){
 
-		{
+		if(resume){
+
+			cout << "Resuming from " << ckpt << endl;
+			lz77.resume(ckpt);
+
+		}else{
+
 			cout << "Detecting alphabet ... " << flush;
 			std::ifstream ifs(in);
 
 			lz77 = lz77_t(ifs, sa_rate);
 
 			cout << "done." << endl;
+
 		}
 
+		lz77.set_checkpoint(ckpt, checkpoint_rate);
+		lz77.set_window(window);
+
 		std::ifstream ifs(in);
-		std::ofstream os(out, ios::binary);
+		std::ofstream os(out, out_mode);
+		lz77_encoder enc(os, coding);
 
-		lz77.parse(ifs,os,1,true);
+		lz77.parse(ifs,enc,1,true);
 
 	}else{
 
 		lz77 = lz77_t(~uint(0), sa_rate);
+
+		if(resume){
+
+			cout << "Resuming from " << ckpt << endl;
+			lz77.resume(ckpt);
+
+		}
+
+		lz77.set_checkpoint(ckpt, checkpoint_rate);
+		lz77.set_window(window);
+
 		std::ifstream ifs(in, ios::binary);
-		std::ofstream os(out, ios::binary);
+		std::ofstream os(out, out_mode);
+		lz77_encoder enc(os, coding, sizeof(int));
 
-		lz77.parse_int(ifs,os,1,true);
+		lz77.parse_int(ifs,enc,1,true);
 
 	}
 
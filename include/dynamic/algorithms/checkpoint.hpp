@@ -0,0 +1,124 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * checkpoint.hpp
+ *
+ *  Periodic checkpoints of the construction algorithms. Every 'rate'
+ *  processed input characters the algorithm saves its state to a file,
+ *  from which a new process can resume the construction.
+ *
+ *  The state is first written to <path>.tmp and then renamed to <path>:
+ *  a crash while writing leaves the previous checkpoint intact.
+ *
+ */
+
+#ifndef INCLUDE_ALGORITHMS_CHECKPOINT_HPP_
+#define INCLUDE_ALGORITHMS_CHECKPOINT_HPP_
+
+#include "dynamic/internal/includes.hpp"
+#include <cstdio>
+
+namespace dyn{
+
+class checkpoint{
+
+public:
+
+	/*
+	 * no checkpoints
+	 */
+	checkpoint(){}
+
+	/*
+	 * save a checkpoint to path every rate input characters (never if rate=0)
+	 */
+	checkpoint(string path, ulint rate) : path(path), rate(rate), next(rate){}
+
+	bool enabled() const {
+
+		return rate > 0;
+
+	}
+
+	/*
+	 * true if a checkpoint has to be saved after processed input characters
+	 */
+	bool due(ulint processed) const {
+
+		return rate > 0 and processed >= next;
+
+	}
+
+	/*
+	 * save the state written by save_state(ostream&), then schedule the next
+	 * checkpoint after other rate characters
+	 */
+	template<class F>
+	void save(ulint processed, F save_state){
+
+		string tmp = path + ".tmp";
+
+		{
+			std::ofstream out(tmp, ios::binary);
+			save_state(out);
+			out.close();
+		}
+
+		std::rename(tmp.c_str(), path.c_str());
+
+		next = processed + rate;
+
+	}
+
+	/*
+	 * processed input characters after which the next checkpoint is saved
+	 */
+	void set_next(ulint processed){
+
+		next = processed + rate;
+
+	}
+
+	static ulint write_word(ostream& out, ulint x){
+
+		out.write((char*)&x,sizeof(x));
+		return sizeof(x);
+
+	}
+
+	static ulint read_word(istream& in){
+
+		ulint x = 0;
+		in.read((char*)&x,sizeof(x));
+		return x;
+
+	}
+
+	/*
+	 * discard the first n bytes of the input (already processed before the
+	 * checkpoint). Uses seekg when the stream supports it.
+	 */
+	static void skip_input(istream& in, ulint n){
+
+		if(n == 0) return;
+
+		if(in.seekg(n, in.cur)) return;
+
+		in.clear();
+		in.ignore(n);
+
+	}
+
+private:
+
+	string path;
+	ulint rate = 0;
+	ulint next = 0;
+
+};
+
+}
+
+#endif /* INCLUDE_ALGORITHMS_CHECKPOINT_HPP_ */
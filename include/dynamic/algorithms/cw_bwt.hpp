@@ -21,6 +21,7 @@
 #include "dynamic/internal/cw_bwt/PartialSums.h"
 #include "dynamic/internal/cw_bwt/DynamicString.h"
 #include "dynamic/internal/cw_bwt/BackwardFileIterator.h"
+#include "dynamic/internal/cw_bwt/BackwardMMapIterator.h"
 #include "dynamic/internal/cw_bwt/BackwardStringIterator.h"
 #include "dynamic/internal/cw_bwt/ContextAutomata.h"
 
@@ -81,8 +82,28 @@ public:
 
 		bool hasNext(){return position<n;};
 
+		//next maximal run <symbol,length> of the BWT. Call only if hasNext()
+		pair<symbol,ulint> nextRun(){
+
+			symbol s = next();
+			ulint k = 1;
+
+			while(hasNext() and peek()==s){
+
+				next();
+				k++;
+
+			}
+
+			return {s,k};
+
+		}
+
 	private:
 
+		//symbol returned by the next call to next()
+		symbol peek(){return bwt->ca.CodeToASCII(bwt->dynStrings[context].at(i));};
+
 		cw_bwt * bwt;
 		ulint context;//pointer to context of next symbol
 		ulint i;//next position to be read in the current context
@@ -101,7 +122,7 @@ public:
 		this->verbose=verbose;
 
 		if(input_type==path)
-			bwIt = new BackwardFileIterator(input_string);
+			bwIt = newFileIterator(input_string);
 		else
 			bwIt = new BackwardStringIterator(input_string);
 
@@ -130,7 +151,7 @@ public:
 		if(verbose) cout << "\nContext length is k = " << k << endl;
 
 		if(input_type==path)
-			bwIt = new BackwardFileIterator(input_string);
+			bwIt = newFileIterator(input_string);
 		else
 			bwIt = new BackwardStringIterator(input_string);
 
@@ -229,6 +250,32 @@ public:
 
 	}
 
+	/*
+	 * load the BWT in a dynamic BWT or FM-index (e.g. dyn::rle_bwt, dyn::wt_bwt,
+	 * dyn::rle_fmi), which must be empty: the runs are streamed into its bulk
+	 * construction (see bwt::build_from_run_stream), without decompressing the
+	 * whole BWT. The 0x0 terminator becomes the terminator of the structure
+	 */
+	template<class bwt_type>
+	void toBWT(bwt_type & bwt){
+
+		cw_bwt_iterator it = getIterator();
+
+		if(verbose) cout << "\nStreaming BWT runs ..." << endl;
+
+		bwt.build_from_run_stream([&]() -> pair<ulint,ulint> {
+
+			if(not it.hasNext()) return {0,0};
+
+			auto r = it.nextRun();
+			return {r.first,r.second};
+
+		}, 0, verbose);
+
+		if(verbose) cout << "Done. " << endl;
+
+	}
+
 	cw_bwt_iterator getIterator(){return cw_bwt_iterator(this);};
 
 	double empiricalEntropy(){return Hk;};//empirical entropy of order k, computed with actual observed frequencies.
@@ -548,6 +595,17 @@ private:
 
 	}
 
+	//backward iterator on a file: memory-mapped where available (see BackwardMMapIterator.h)
+	static BackwardIterator * newFileIterator(string &path){
+
+#ifdef BWTIL_HAS_MMAP
+		return new BackwardMMapIterator(path);
+#else
+		return new BackwardFileIterator(path);
+#endif
+
+	}
+
 	bool verbose = 0;
 
 	uint k = 0;//context length and order of compression (entropy H_k). default: k = ceil( log_sigma(n/log^3 n) )
@@ -13,6 +13,11 @@
  *
  * From the paper: Alberto Policriti and Nicola Prezza, "Fast Online Lempel-Ziv Factorization in Compressed Space"
  *
+ * With a window (set_window), the index keeps only the last characters of the
+ * input (fm_index::shrink): phrases copy from the window and the memory does
+ * not grow with the input. The window is restored at the end of each phrase,
+ * hence it can temporarily exceed its size by the length of the current phrase.
+ *
  */
 //============================================================================
 
@@ -21,6 +26,8 @@
 #define H0_LZ77_PARSER_H_
 
 #include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+#include "dynamic/algorithms/checkpoint.hpp"
 
 namespace dyn {
 
@@ -117,38 +124,70 @@ public:
 	 */
 	void parse(istream& in, ostream& out, ulint skip = 1, bool verbose = false){
 
-		//size of the output if this is compressed using gamma/delta encoding
-		uint64_t gamma_bits = 0;
-		uint64_t delta_bits = 0;
+		lz77_encoder enc(out, lz77_coding::raw, 1);
+		parse(in, enc, skip, verbose);
+
+	}
+
+	/*
+	 * as above, but the triples are written with the given encoder
+	 * (see lz77_format.hpp), which must use 1-byte characters.
+	 * skip>1 requires raw coding
+	 */
+	void parse(istream& in, lz77_encoder& out, ulint skip = 1, bool verbose = false){
+
+		assert(out.character_bytes()==1);
+		assert(skip==1 or out.get_coding()==lz77_coding::raw);
+
+		//the parse variables are saved by the checkpoints (see parse_state)
+		uint64_t& gamma_bits = state.gamma_bits;
+		uint64_t& delta_bits = state.delta_bits;
 
 		assert(skip>0);
 
 		long int step = 1000000;	//print status every step characters
 		long int last_step = 0;
 
-		assert(fmi.size()==1);	//only terminator
+		assert(state.bytes > 0 or fmi.size()==1);	//only terminator
 
-		pair<ulint, ulint> range = fmi.get_full_interval();	//BWT range of current phrase
+		pair<ulint, ulint>& range = state.range;
 
-		ulint len = 0;	//length of current LZ phrase
-		ulint i = 0;	//position of terminator character in bwt
-		ulint p = 0;	//phrase occurrence
+		ulint& len = state.len;
+		ulint& i = state.i;
+		ulint& p = state.p;
 
-		ulint z = 0; 	//number of LZ77 phrases
+		ulint& z = state.z;
 
 		if(verbose) cout << "Parsing ..." << endl;
 
+		//when resuming, skip the input processed before the checkpoint
+		ulint start = state.bytes;
+		checkpoint::skip_input(in, start);
+		ckpt.set_next(start);
+
+		if(not enc_state.empty()){
+
+			std::istringstream es(enc_state);
+			out.load(es);
+			enc_state.clear();
+
+		}
+
+		input_reader reader(in);
+
 		char cc;
-		while(in.get(cc)){
+		while(reader.get(cc)){
 
 			//cout << cc;
 
 			if(verbose){
 
-				if(fmi.text_length()>last_step+(step-1)){
+				ulint n = fmi.text_length() + fmi.removed_characters();
 
-					last_step = fmi.text_length();
-					cout << " " << fmi.text_length() << " characters processed ..." << endl;
+				if(n>last_step+(step-1)){
+
+					last_step = n;
+					cout << " " << n << " characters processed ..." << endl;
 
 				}
 
@@ -169,22 +208,20 @@ public:
 				if(len>0){
 
 					occ = i == range.first ? range.second-1 : range.first;
-					p = fmi.locate(occ) - len;
+					p = fmi.locate(occ) + fmi.removed_characters() - len;
 
 				}
 
 				fmi.extend(c);
 
-				uint64_t backward_pos = len == 0 ? 0 : (fmi.text_length() - len - 1) - p;
+				uint64_t backward_pos = len == 0 ? 0 : (fmi.text_length() + fmi.removed_characters() - len - 1) - p;
 
 				if(backward_pos > fmi.text_length()){
 					cout << "err" << endl;
 					exit(0);
 				}
 
-				out.write((char*)&p,sizeof(ulint));
-				out.write((char*)&len,sizeof(ulint));
-				out.write((char*)&cc,sizeof(cc));
+				out.add(p, len, uchar(cc));
 
 				gamma_bits += gamma(uint64_t(backward_pos+1));
 				gamma_bits += gamma(uint64_t(len+1));
@@ -202,7 +239,7 @@ public:
 
 				ulint k = 0;
 
-				while(k < skip-1 && in.get(cc)){
+				while(k < skip-1 && reader.get(cc)){
 
 					//cout << cc;
 
@@ -213,6 +250,8 @@ public:
 
 				//cout << "|";
 
+				slide_window();
+
 				range = fmi.get_full_interval();
 
 			}else{
@@ -224,14 +263,21 @@ public:
 
 			}
 
+			state.bytes = start + reader.bytes();
+
+			if(ckpt.due(state.bytes)) save_checkpoint(out);
 
 		}
 
+		out.close();
+
 		if(verbose){
 
+			double n = fmi.text_length() + fmi.removed_characters();
+
 			cout << "\nNumber of LZ77 phrases: " << z << endl;
-			cout << "gamma complexity of the output: " << (gamma_bits/8)+1 << " Bytes, " << double(gamma_bits)/double(fmi.text_length()) << " bit/symbol" << endl;
-			cout << "delta complexity of the output: " << (delta_bits/8)+1 << " Bytes, " << double(delta_bits)/double(fmi.text_length()) << " bit/symbol" << endl;
+			cout << "gamma complexity of the output: " << (gamma_bits/8)+1 << " Bytes, " << double(gamma_bits)/n << " bit/symbol" << endl;
+			cout << "delta complexity of the output: " << (delta_bits/8)+1 << " Bytes, " << double(delta_bits)/n << " bit/symbol" << endl;
 
 
 		}
@@ -256,30 +302,60 @@ public:
 	 */
 	void parse_int(istream& in, ostream& out, ulint skip = 1, bool verbose = false){
 
-		//size of the output if this is compressed using gamma/delta encoding
-		uint64_t gamma_bits = 0;
-		uint64_t delta_bits = 0;
+		lz77_encoder enc(out, lz77_coding::raw, 4);
+		parse_int(in, enc, skip, verbose);
+
+	}
+
+	/*
+	 * as above, but the triples are written with the given encoder
+	 * (see lz77_format.hpp), which must use 4-byte characters.
+	 * skip>1 requires raw coding
+	 */
+	void parse_int(istream& in, lz77_encoder& out, ulint skip = 1, bool verbose = false){
+
+		assert(out.character_bytes()==4);
+		assert(skip==1 or out.get_coding()==lz77_coding::raw);
+
+		//the parse variables are saved by the checkpoints (see parse_state)
+		uint64_t& gamma_bits = state.gamma_bits;
+		uint64_t& delta_bits = state.delta_bits;
 
 		assert(skip>0);
 
 		long int step = 100000;	//print status every step characters
 		long int last_step = 0;
 
-		assert(fmi.size()==1);	//only terminator
+		assert(state.bytes > 0 or fmi.size()==1);	//only terminator
 
-		pair<ulint, ulint> range = fmi.get_full_interval();	//BWT range of current phrase
+		pair<ulint, ulint>& range = state.range;
 
-		ulint len = 0;	//length of current LZ phrase
-		ulint i = 0;	//position of terminator character in bwt
-		ulint p = 0;	//phrase occurrence
+		ulint& len = state.len;
+		ulint& i = state.i;
+		ulint& p = state.p;
 
-		ulint z = 0; 	//number of LZ77 phrases
+		ulint& z = state.z;
 
 		if(verbose) cout << "Parsing ..." << endl;
 
+		//when resuming, skip the input processed before the checkpoint
+		ulint start = state.bytes;
+		checkpoint::skip_input(in, start);
+		ckpt.set_next(start);
+
+		if(not enc_state.empty()){
+
+			std::istringstream es(enc_state);
+			out.load(es);
+			enc_state.clear();
+
+		}
+
+		input_reader reader(in);
+
 		int cc;
-		ulint n = 0;
-		while(in.read((char*)&cc,sizeof(int))){
+		ulint n = start/sizeof(int);
+		while(reader.read((char*)&cc,sizeof(int))){
 
 			n++;
 			//cout << cc;
@@ -310,22 +386,20 @@ public:
 				if(len>0){
 
 					occ = i == range.first ? range.second-1 : range.first;
-					p = fmi.locate(occ) - len;
+					p = fmi.locate(occ) + fmi.removed_characters() - len;
 
 				}
 
 				fmi.extend(c);
 
-				uint64_t backward_pos = len == 0 ? 0 : (fmi.text_length() - len - 1) - p;
+				uint64_t backward_pos = len == 0 ? 0 : (fmi.text_length() + fmi.removed_characters() - len - 1) - p;
 
 				if(backward_pos > fmi.text_length()){
 					cout << "err" << endl;
 					exit(0);
 				}
 
-				out.write((char*)&p,sizeof(ulint));
-				out.write((char*)&len,sizeof(ulint));
-				out.write((char*)&cc,sizeof(cc));
+				out.add(p, len, uint(cc));
 
 				z++;
 				len = 0;
@@ -335,7 +409,7 @@ public:
 
 				ulint k = 0;
 
-				while(k < skip-1 && in.read((char*)&cc,sizeof(int))){
+				while(k < skip-1 && reader.read((char*)&cc,sizeof(int))){
 
 					//cout << cc;
 
@@ -347,6 +421,8 @@ public:
 
 				//cout << "|";
 
+				slide_window();
+
 				range = fmi.get_full_interval();
 
 			}else{
@@ -358,9 +434,14 @@ public:
 
 			}
 
+			state.bytes = start + reader.bytes();
+
+			if(ckpt.due(state.bytes)) save_checkpoint(out);
 
 		}
 
+		out.close();
+
 		if(verbose){
 
 			cout << "\nNumber of integers: " << n << endl;
@@ -373,6 +454,54 @@ public:
 	}
 
 
+	/*
+	 * index only the last w input characters (0 = the whole input). Use
+	 * the same window when resuming from a checkpoint
+	 */
+	void set_window(ulint w){
+
+		window = w;
+
+	}
+
+	/*
+	 * during parse/parse_int, save the state (index, parse variables and
+	 * output encoder) to path every rate input bytes
+	 */
+	void set_checkpoint(string path, ulint rate){
+
+		ckpt = checkpoint(path, rate);
+
+	}
+
+	/*
+	 * load the state saved in a checkpoint file. The next call to
+	 * parse/parse_int, on the same input and with an encoder on the same
+	 * output file (opened without truncating it), continues from where the
+	 * checkpoint was saved
+	 */
+	void resume(string path){
+
+		std::ifstream in(path, ios::binary);
+
+		fmi = dyn_fmi();
+		fmi.load(in);
+
+		state.bytes = checkpoint::read_word(in);
+		state.range.first = checkpoint::read_word(in);
+		state.range.second = checkpoint::read_word(in);
+		state.len = checkpoint::read_word(in);
+		state.i = checkpoint::read_word(in);
+		state.p = checkpoint::read_word(in);
+		state.z = checkpoint::read_word(in);
+		state.gamma_bits = checkpoint::read_word(in);
+		state.delta_bits = checkpoint::read_word(in);
+
+		//the rest is the encoder state, loaded by parse
+		enc_state = string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	}
+
 	/*
 	 * Total number of bits allocated in RAM for this structure
 	 *
@@ -392,9 +521,64 @@ public:
 
 private:
 
+	/*
+	 * variables of parse/parse_int
+	 */
+	struct parse_state{
+
+		ulint bytes = 0;	//input bytes processed
+
+		pair<ulint, ulint> range = {0,1};	//BWT range of current phrase
+
+		ulint len = 0;	//length of current LZ phrase
+		ulint i = 0;	//position of terminator character in bwt
+		ulint p = 0;	//phrase occurrence
+
+		ulint z = 0; 	//number of LZ77 phrases
+
+		//size of the output if this is compressed using gamma/delta encoding
+		uint64_t gamma_bits = 0;
+		uint64_t delta_bits = 0;
+
+	};
+
+	void save_checkpoint(lz77_encoder& out){
+
+		ckpt.save(state.bytes, [this,&out](ostream& o){
+
+			fmi.serialize(o);
+
+			for(auto x : {state.bytes, state.range.first, state.range.second, state.len, state.i, state.p, state.z, state.gamma_bits, state.delta_bits})
+				checkpoint::write_word(o, x);
+
+			out.serialize(o);
+
+		});
+
+	}
+
+	/*
+	 * remove the characters before the window (between two phrases: the
+	 * BWT rows move)
+	 */
+	void slide_window(){
+
+		while(window > 0 and fmi.text_length() > window) fmi.shrink();
+
+	}
+
 	//the dynamic compressed BWT
 	dyn_fmi fmi;
 
+	//number of input characters indexed (0 = all)
+	ulint window = 0;
+
+	parse_state state;
+	checkpoint ckpt;
+
+	//encoder state read by resume
+	string enc_state;
+
 };
 
 } /* namespace data_structures */
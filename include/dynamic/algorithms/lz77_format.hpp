@@ -0,0 +1,871 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * lz77_format.hpp
+ *
+ *  Compact binary format for LZ77 parses, with a buffered encoder (used by
+ *  the LZ77 parsers) and a block-parallel decoder.
+ *
+ *  A phrase is a triple <start,len,c>: copy len characters from text
+ *  position start (the source may overlap the phrase), then append c.
+ *  The encoder stores the source as the distance d = pos-start >= 1 from the
+ *  phrase position pos (omitted if len=0), which is small for repetitive
+ *  texts, and codes len, d and c with one of:
+ *
+ *   - varint: 7 bits per byte, little-endian, high bit = more bytes follow
+ *   - gamma:  Elias gamma codes of len+1, d, c+1
+ *   - delta:  Elias delta codes of len+1, d, c+1
+ *
+ *  File layout (all integers are 64-bit little-endian words):
+ *
+ *   header: magic "DYNLZ77", format version (1 byte), coding, phrases per
+ *           block, bytes per character of the decoded text
+ *   blocks: phrases_per_block phrases each (the last one can be shorter).
+ *           Each block starts on a byte boundary
+ *   index:  number of blocks, number of phrases, text length, then for
+ *           each block: byte offset in the file and text position of its
+ *           first phrase
+ *   footer: byte offset of the index
+ *
+ *  The index allows to decode blocks independently (and in parallel).
+ *
+ *  The raw coding writes the legacy format: no header/index, one
+ *  <ulint start, ulint len, c> triple per phrase, with c on char_bytes bytes.
+ *  Sparsified parses (skip > 1, see the parsers) can be written only in
+ *  this format, since the skipped characters are not stored.
+ *
+ */
+
+#ifndef INCLUDE_ALGORITHMS_LZ77_FORMAT_HPP_
+#define INCLUDE_ALGORITHMS_LZ77_FORMAT_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn{
+
+/*
+ * a LZ77 phrase: copy len characters starting from text position start,
+ * then append c
+ */
+struct lz77_phrase{
+
+	ulint start;
+	ulint len;
+	ulint c;
+
+};
+
+enum class lz77_coding : ulint { raw = 0, varint = 1, gamma = 2, delta = 3 };
+
+/*
+ * coding from its name (raw, varint, gamma, delta). Returns false if
+ * the name is not recognized
+ */
+inline bool lz77_coding_from_string(const string& s, lz77_coding& coding){
+
+	if(s == "raw") coding = lz77_coding::raw;
+	else if(s == "varint") coding = lz77_coding::varint;
+	else if(s == "gamma") coding = lz77_coding::gamma;
+	else if(s == "delta") coding = lz77_coding::delta;
+	else return false;
+
+	return true;
+
+}
+
+/*
+ * bit-level and byte-level writer/reader of the phrase codes
+ */
+class lz77_codes{
+
+public:
+
+	/*
+	 * append x (x < 2^64) using b <= 64 bits, most significant first
+	 */
+	static void write_bits(vector<uint8_t>& buf, uint64_t& acc, ulint& bits, uint64_t x, ulint b){
+
+		while(b > 32){
+
+			write_bits(buf, acc, bits, x >> 32, b - 32);
+			b = 32;
+			x &= 0xFFFFFFFF;
+
+		}
+
+		acc = (acc << b) | x;
+		bits += b;
+
+		while(bits >= 8){
+
+			bits -= 8;
+			buf.push_back(uint8_t(acc >> bits));
+
+		}
+
+	}
+
+	/*
+	 * flush the remaining bits (the last byte is padded with 0s)
+	 */
+	static void flush_bits(vector<uint8_t>& buf, uint64_t& acc, ulint& bits){
+
+		if(bits > 0) buf.push_back(uint8_t(acc << (8 - bits)));
+
+		acc = 0;
+		bits = 0;
+
+	}
+
+	/*
+	 * number of bits of x > 0
+	 */
+	static ulint bit_size(uint64_t x){
+
+		return 64 - __builtin_clzll(x);
+
+	}
+
+	static void write_gamma(vector<uint8_t>& buf, uint64_t& acc, ulint& bits, uint64_t x){
+
+		assert(x > 0);
+
+		ulint b = bit_size(x);
+
+		write_bits(buf, acc, bits, 0, b-1);
+		write_bits(buf, acc, bits, x, b);
+
+	}
+
+	static void write_delta(vector<uint8_t>& buf, uint64_t& acc, ulint& bits, uint64_t x){
+
+		assert(x > 0);
+
+		ulint b = bit_size(x);
+
+		write_gamma(buf, acc, bits, b);
+		write_bits(buf, acc, bits, x & ((uint64_t(1) << (b-1)) - 1), b-1);
+
+	}
+
+	static void write_varint(vector<uint8_t>& buf, uint64_t x){
+
+		while(x >= 128){
+
+			buf.push_back(uint8_t(x | 128));
+			x >>= 7;
+
+		}
+
+		buf.push_back(uint8_t(x));
+
+	}
+
+	/*
+	 * reads a block, starting at the given byte
+	 */
+	class reader{
+
+	public:
+
+		/*
+		 * the buffer must have 8 bytes of padding after the data
+		 */
+		reader(const uint8_t* data) : data(data) {}
+
+		uint64_t read_varint(){
+
+			uint64_t x = 0;
+			ulint shift = 0;
+
+			uint8_t b;
+
+			do{
+
+				b = data[pos/8];
+				x |= uint64_t(b & 127) << shift;
+				shift += 7;
+				pos += 8;
+
+			}while(b & 128);
+
+			return x;
+
+		}
+
+		/*
+		 * next b <= 57 bits
+		 */
+		uint64_t read_bits(ulint b){
+
+			if(b == 0) return 0;
+
+			uint64_t x = peek() >> (64 - b);
+			pos += b;
+
+			return x;
+
+		}
+
+		uint64_t read_gamma(){
+
+			//z zeros, then z+1 bits starting with 1
+			ulint z = 0;
+
+			uint64_t w;
+			while((w = peek() >> 7) == 0){
+
+				z += 57;
+				pos += 57;
+
+			}
+
+			ulint lz = __builtin_clzll(w) - 7;
+
+			z += lz;
+			pos += lz;
+
+			if(z < 57) return read_bits(z+1);
+
+			uint64_t hi = read_bits(z+1-32);
+			return (hi << 32) | read_bits(32);
+
+		}
+
+		uint64_t read_delta(){
+
+			ulint b = read_gamma();
+
+			if(b <= 57) return (uint64_t(1) << (b-1)) | read_bits(b-1);
+
+			uint64_t hi = read_bits(b-1-32);
+			return (uint64_t(1) << (b-1)) | (hi << 32) | read_bits(32);
+
+		}
+
+	private:
+
+		/*
+		 * the next 57 bits in the most significant positions
+		 */
+		uint64_t peek() const {
+
+			uint64_t w = 0;
+			for(ulint i=0;i<8;++i) w = (w << 8) | data[pos/8 + i];
+
+			return w << (pos%8);
+
+		}
+
+		const uint8_t* data;
+		ulint pos = 0;	//in bits
+
+	};
+
+};
+
+/*
+ * buffered encoder: phrases are coded in a memory buffer and written
+ * to the output stream one block at a time. The header is written at
+ * construction, the index by close() (called also by the destructor)
+ */
+class lz77_encoder{
+
+public:
+
+	static const ulint DEFAULT_BLOCK_SIZE = 1<<16;
+
+	explicit lz77_encoder(ostream& out, lz77_coding coding = lz77_coding::varint, ulint char_bytes = 1, ulint block_size = DEFAULT_BLOCK_SIZE) :
+		out(out), coding(coding), char_bytes(char_bytes), block_size(block_size){
+
+		assert(block_size > 0);
+		assert(char_bytes == 1 or char_bytes == 2 or char_bytes == 4 or char_bytes == 8);
+
+		if(coding == lz77_coding::raw) return;
+
+		write_word(MAGIC);
+		write_word(ulint(coding));
+		write_word(block_size);
+		write_word(char_bytes);
+
+	}
+
+	~lz77_encoder(){
+
+		close();
+
+	}
+
+	/*
+	 * append phrase <start,len,c>
+	 */
+	void add(ulint start, ulint len, ulint c){
+
+		assert(char_bytes == 8 or c < (ulint(1) << (8*char_bytes)));
+
+		if(coding == lz77_coding::raw){
+
+			out.write((char*)&start,sizeof(ulint));
+			out.write((char*)&len,sizeof(ulint));
+			out.write((char*)&c,char_bytes);
+
+			offset += 2*sizeof(ulint) + char_bytes;
+			pos += len+1;
+			z++;
+
+			return;
+
+		}
+
+		assert(len == 0 or start < pos);
+
+		if(in_block == 0) block_pos.push_back(pos);
+
+		ulint d = len == 0 ? 0 : pos - start;
+
+		switch(coding){
+
+			case lz77_coding::varint :
+
+				lz77_codes::write_varint(buf, len);
+				if(len > 0) lz77_codes::write_varint(buf, d);
+				lz77_codes::write_varint(buf, c);
+
+			break;
+
+			case lz77_coding::gamma :
+
+				lz77_codes::write_gamma(buf, acc, bits, len+1);
+				if(len > 0) lz77_codes::write_gamma(buf, acc, bits, d);
+				lz77_codes::write_gamma(buf, acc, bits, c+1);
+
+			break;
+
+			case lz77_coding::delta :
+
+				lz77_codes::write_delta(buf, acc, bits, len+1);
+				if(len > 0) lz77_codes::write_delta(buf, acc, bits, d);
+				lz77_codes::write_delta(buf, acc, bits, c+1);
+
+			break;
+
+			default : break;
+
+		}
+
+		pos += len+1;
+		z++;
+
+		if(++in_block == block_size) flush_block();
+
+	}
+
+	void add(lz77_phrase p){
+
+		add(p.start, p.len, p.c);
+
+	}
+
+	/*
+	 * write the last block and the index
+	 */
+	void close(){
+
+		if(closed) return;
+		closed = true;
+
+		if(coding == lz77_coding::raw){
+
+			out.flush();
+			return;
+
+		}
+
+		if(in_block > 0) flush_block();
+
+		ulint index = offset;
+
+		write_word(block_offset.size());
+		write_word(z);
+		write_word(pos);
+
+		for(ulint b=0;b<block_offset.size();++b){
+
+			write_word(block_offset[b]);
+			write_word(block_pos[b]);
+
+		}
+
+		write_word(index);
+
+		out.flush();
+
+	}
+
+	lz77_coding get_coding() const {
+
+		return coding;
+
+	}
+
+	ulint character_bytes() const {
+
+		return char_bytes;
+
+	}
+
+	/*
+	 * bytes written so far
+	 */
+	ulint bytes() const {
+
+		return offset + buf.size();
+
+	}
+
+	ulint number_of_phrases() const {
+
+		return z;
+
+	}
+
+	/*
+	 * length of the text parsed so far
+	 */
+	ulint text_length() const {
+
+		return pos;
+
+	}
+
+	/*
+	 * save the encoder state (used by the parsers' checkpoints). The output
+	 * stream is flushed first, so that the out bytes counted in the state
+	 * are on disk
+	 */
+	ulint serialize(ostream& state){
+
+		out.flush();
+
+		ulint w_bytes = 0;
+
+		for(auto x : {ulint(coding), char_bytes, block_size, acc, bits, in_block, offset, pos, z})
+			w_bytes += write_word(state, x);
+
+		w_bytes += write_vector(state, buf);
+		w_bytes += write_vector(state, block_offset);
+		w_bytes += write_vector(state, block_pos);
+
+		return w_bytes;
+
+	}
+
+	/*
+	 * restore a state saved by serialize() and move the output stream at the
+	 * point where the state was saved. The encoder must use the same coding.
+	 * The bytes after that point (if any) are overwritten by the same bytes,
+	 * since the parse is deterministic
+	 */
+	void load(istream& state){
+
+		ulint c;
+
+		read_word(state, c);
+		assert(c == ulint(coding));
+
+		for(auto x : {&char_bytes, &block_size, &acc, &bits, &in_block, &offset, &pos, &z})
+			read_word(state, *x);
+
+		read_vector(state, buf);
+		read_vector(state, block_offset);
+		read_vector(state, block_pos);
+
+		out.seekp(offset, out.beg);
+
+	}
+
+	//"DYNLZ77" + format version 1
+	static const ulint MAGIC = 0x0137375A4C4E5944;
+
+private:
+
+	static ulint write_word(ostream& o, ulint x){
+
+		o.write((char*)&x,sizeof(x));
+		return sizeof(x);
+
+	}
+
+	static void read_word(istream& i, ulint& x){
+
+		i.read((char*)&x,sizeof(x));
+
+	}
+
+	template<typename T>
+	static ulint write_vector(ostream& o, const vector<T>& v){
+
+		ulint w_bytes = write_word(o, v.size());
+
+		o.write((char*)v.data(), v.size()*sizeof(T));
+
+		return w_bytes + v.size()*sizeof(T);
+
+	}
+
+	template<typename T>
+	static void read_vector(istream& i, vector<T>& v){
+
+		ulint size;
+		read_word(i, size);
+
+		v.resize(size);
+		i.read((char*)v.data(), size*sizeof(T));
+
+	}
+
+	void flush_block(){
+
+		lz77_codes::flush_bits(buf, acc, bits);
+
+		block_offset.push_back(offset);
+
+		out.write((char*)buf.data(), buf.size());
+		offset += buf.size();
+
+		buf.clear();
+		in_block = 0;
+
+	}
+
+	void write_word(ulint x){
+
+		out.write((char*)&x,sizeof(x));
+		offset += sizeof(x);
+
+	}
+
+	ostream& out;
+
+	lz77_coding coding;
+	ulint char_bytes;
+	ulint block_size;
+
+	//current block
+	vector<uint8_t> buf;
+	uint64_t acc = 0;
+	ulint bits = 0;
+	ulint in_block = 0;
+
+	//byte offset and first text position of the blocks
+	vector<ulint> block_offset;
+	vector<ulint> block_pos;
+
+	ulint offset = 0;	//bytes written to out
+	ulint pos = 0;		//text length
+	ulint z = 0;		//phrases
+
+	bool closed = false;
+
+};
+
+/*
+ * decoder of the compact format. Blocks are decoded independently: the
+ * phrase codes of all blocks are decoded in parallel (OpenMP), then the
+ * copies are resolved left to right (a memory-bound pass, since sources can
+ * lie in any previous block)
+ */
+class lz77_decoder{
+
+public:
+
+	/*
+	 * read header and index (the stream must be seekable)
+	 */
+	lz77_decoder(istream& in) : in(in){
+
+		in.seekg(0, in.end);
+		ulint file_size = in.tellg();
+
+		assert(file_size >= 6*sizeof(ulint));
+
+		in.seekg(0, in.beg);
+
+		ulint magic;
+		read_word(magic);
+
+		if(magic != lz77_encoder::MAGIC){
+
+			valid = false;
+			return;
+
+		}
+
+		ulint c;
+		read_word(c);
+		coding = lz77_coding(c);
+
+		read_word(block_size);
+		read_word(char_bytes);
+
+		ulint index;
+		in.seekg(file_size - sizeof(ulint), in.beg);
+		read_word(index);
+
+		in.seekg(index, in.beg);
+
+		ulint n_blocks;
+		read_word(n_blocks);
+		read_word(z);
+		read_word(n);
+
+		block_offset.resize(n_blocks+1);
+		block_pos.resize(n_blocks+1);
+
+		for(ulint b=0;b<n_blocks;++b){
+
+			read_word(block_offset[b]);
+			read_word(block_pos[b]);
+
+		}
+
+		//sentinels
+		block_offset[n_blocks] = index;
+		block_pos[n_blocks] = n;
+
+	}
+
+	/*
+	 * false if the stream is not in the compact format
+	 */
+	bool is_valid() const {
+
+		return valid;
+
+	}
+
+	ulint number_of_blocks() const {
+
+		return block_offset.size()-1;
+
+	}
+
+	ulint number_of_phrases() const {
+
+		return z;
+
+	}
+
+	ulint text_length() const {
+
+		return n;
+
+	}
+
+	/*
+	 * bytes per character of the decoded text
+	 */
+	ulint character_bytes() const {
+
+		return char_bytes;
+
+	}
+
+	lz77_coding get_coding() const {
+
+		return coding;
+
+	}
+
+	/*
+	 * decode the phrases of block b
+	 */
+	vector<lz77_phrase> block(ulint b) const {
+
+		assert(b < number_of_blocks());
+
+		vector<uint8_t> data;
+		read_block(b, data);
+
+		return decode_block(b, data);
+
+	}
+
+	/*
+	 * decode the whole text in T (character i in T[i]). Phrase codes
+	 * are decoded in parallel, one block per task
+	 */
+	template<typename char_type>
+	void decode(vector<char_type>& T) const {
+
+		ulint B = number_of_blocks();
+
+		vector<vector<lz77_phrase> > phrases(B);
+		vector<vector<uint8_t> > data(B);
+
+		//reading is sequential, decoding is parallel
+		for(ulint b=0;b<B;++b) read_block(b, data[b]);
+
+		#pragma omp parallel for schedule(dynamic)
+		for(ulint b=0;b<B;++b){
+
+			phrases[b] = decode_block(b, data[b]);
+			vector<uint8_t>().swap(data[b]);
+
+		}
+
+		T.resize(n);
+
+		ulint pos = 0;
+
+		for(ulint b=0;b<B;++b){
+
+			for(auto p : phrases[b]){
+
+				if(p.len > 0){
+
+					assert(p.start < pos);
+
+					//sources overlapping the phrase are copied forward
+					if(p.start + p.len <= pos) std::copy(T.begin()+p.start, T.begin()+p.start+p.len, T.begin()+pos);
+					else for(ulint k=0;k<p.len;++k) T[pos+k] = T[p.start+k];
+
+				}
+
+				T[pos + p.len] = char_type(p.c);
+				pos += p.len+1;
+
+			}
+
+			vector<lz77_phrase>().swap(phrases[b]);
+
+		}
+
+		assert(pos == n);
+
+	}
+
+	/*
+	 * decode the text to the output stream (char_bytes bytes per character)
+	 */
+	void decompress(ostream& out) const {
+
+		switch(char_bytes){
+
+			case 1 : decompress_<uint8_t>(out); break;
+			case 2 : decompress_<uint16_t>(out); break;
+			case 4 : decompress_<uint32_t>(out); break;
+			default : decompress_<uint64_t>(out); break;
+
+		}
+
+	}
+
+private:
+
+	template<typename char_type>
+	void decompress_(ostream& out) const {
+
+		vector<char_type> T;
+		decode(T);
+
+		out.write((char*)T.data(), T.size()*sizeof(char_type));
+
+	}
+
+	/*
+	 * bytes of block b, with 8 bytes of padding
+	 */
+	void read_block(ulint b, vector<uint8_t>& data) const {
+
+		ulint size = block_offset[b+1] - block_offset[b];
+
+		data.assign(size + 8, 0);
+
+		in.seekg(block_offset[b], in.beg);
+		in.read((char*)data.data(), size);
+
+	}
+
+	vector<lz77_phrase> decode_block(ulint b, const vector<uint8_t>& data) const {
+
+		//number of phrases in the block
+		ulint k = b+1 < number_of_blocks() ? block_size : z - b*block_size;
+
+		vector<lz77_phrase> res(k);
+
+		lz77_codes::reader R(data.data());
+
+		ulint pos = block_pos[b];
+
+		for(auto& p : res){
+
+			ulint d = 0;
+
+			switch(coding){
+
+				case lz77_coding::varint :
+
+					p.len = R.read_varint();
+					if(p.len > 0) d = R.read_varint();
+					p.c = R.read_varint();
+
+				break;
+
+				case lz77_coding::gamma :
+
+					p.len = R.read_gamma()-1;
+					if(p.len > 0) d = R.read_gamma();
+					p.c = R.read_gamma()-1;
+
+				break;
+
+				default :
+
+					p.len = R.read_delta()-1;
+					if(p.len > 0) d = R.read_delta();
+					p.c = R.read_delta()-1;
+
+				break;
+
+			}
+
+			p.start = p.len > 0 ? pos - d : 0;
+			pos += p.len+1;
+
+		}
+
+		assert(pos == block_pos[b+1]);
+
+		return res;
+
+	}
+
+	void read_word(ulint& x) const {
+
+		in.read((char*)&x,sizeof(x));
+
+	}
+
+	istream& in;
+
+	bool valid = true;
+
+	lz77_coding coding = lz77_coding::varint;
+	ulint block_size = 0;
+	ulint char_bytes = 1;
+
+	ulint z = 0;	//phrases
+	ulint n = 0;	//text length
+
+	//byte offset and first text position of the blocks (+ sentinels)
+	vector<ulint> block_offset;
+	vector<ulint> block_pos;
+
+};
+
+}
+
+#endif /* INCLUDE_ALGORITHMS_LZ77_FORMAT_HPP_ */
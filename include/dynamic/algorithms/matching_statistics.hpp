@@ -0,0 +1,226 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+//============================================================================
+// Name        : matching_statistics.hpp
+// Author      : Nicola Prezza
+// Version     : 1.0
+
+/*
+ * Matching statistics and maximal exact matches (MEMs) of query strings
+ * against a dynamic BWT / FM index / r-index.
+ *
+ * MS[i] is the length of the longest prefix of Q[i..] that occurs in the
+ * indexed text. The query is scanned right to left keeping one BWT row q
+ * whose suffix starts with Q[i..i+MS[i]) (instead of the BWT interval):
+ *
+ * - if L[q] = Q[i-1], then MS[i-1] = MS[i]+1 and q = LF(q).
+ * - otherwise, the rows whose suffixes share the longest prefix with the
+ *   suffix of q are the closest rows above and below q ending with Q[i-1].
+ *   After LF, these are the two rows around LF(q,Q[i-1]): we compare their
+ *   suffixes with the query (F column + FL) and keep the longest match.
+ *
+ * The interval never has to be contracted, so there is no restart of the
+ * backward search: the cost is O(m + sum of MS[i-1] over the mismatching
+ * positions) LF/FL steps for a query of length m. MEMs are then read from
+ * the MS array: Q[i..i+MS[i]) is a MEM iff i = 0 or MS[i-1] <= MS[i].
+ *
+ */
+//============================================================================
+
+#ifndef MATCHING_STATISTICS_H_
+#define MATCHING_STATISTICS_H_
+
+#include <tuple>
+
+#include "dynamic/dynamic.hpp"
+
+namespace dyn {
+
+template <	class dyn_bwt	//dynamic BWT (or FM index/r-index)
+		>
+class matching_statistics {
+
+public:
+
+	using char_type = ulint;
+
+	/*
+	 * maximal exact match: <offset in the query, length, BWT interval>
+	 */
+	typedef std::tuple<ulint, ulint, pair<ulint,ulint> > mem;
+
+	/*
+	 * the index must outlive this object
+	 */
+	matching_statistics(const dyn_bwt& B) : B(B){}
+
+	/*
+	 * input: query Q
+	 * output: the matching statistics of Q, as pairs <MS[i], row> where
+	 * row is a BWT row whose suffix starts with Q[i..i+MS[i]) (undefined
+	 * if MS[i] = 0). With an FM index, locate(row) gives an occurrence.
+	 */
+	vector<pair<ulint,ulint> > compute(const vector<char_type>& Q) const {
+
+		ulint m = Q.size();
+		vector<pair<ulint,ulint> > MS(m);
+
+		ulint l = 0;	//MS[i]
+		ulint q = 0;	//row of the match
+
+		for(ulint i=m;i>0;--i){
+
+			char_type c = Q[i-1];
+
+			if(l > 0 and B.at(q) == c){
+
+				q = B.LF(q);
+				l++;
+
+			}else{
+
+				//the F block of c (empty if c does not occur)
+				auto block = B.LF({0,B.size()},c);
+
+				if(block.second <= block.first){
+
+					l = 0;
+					q = 0;
+
+				}else if(l == 0){
+
+					l = 1;
+					q = block.first;
+
+				}else{
+
+					//rows after LF of the closest c above q and of the closest c below q
+					ulint r = B.LF(q,c);
+
+					ulint best = 0;
+					ulint best_row = r < block.second ? r : r-1;
+
+					if(r > block.first){
+
+						ulint k = lce(B.FL(r-1), Q, i, l);
+						if(k >= best){ best = k; best_row = r-1; }
+
+					}
+
+					if(r < block.second and best < l){
+
+						ulint k = lce(B.FL(r), Q, i, l);
+						if(k > best){ best = k; best_row = r; }
+
+					}
+
+					l = best+1;
+					q = best_row;
+
+				}
+
+			}
+
+			MS[i-1] = {l,q};
+
+		}
+
+		return MS;
+
+	}
+
+	/*
+	 * input: query Q
+	 * output: the matching statistics lengths of Q
+	 */
+	vector<ulint> lengths(const vector<char_type>& Q) const {
+
+		auto MS = compute(Q);
+
+		vector<ulint> res(MS.size());
+		for(ulint i=0;i<MS.size();++i) res[i] = MS[i].first;
+
+		return res;
+
+	}
+
+	/*
+	 * input: query Q and minimum length
+	 * output: the MEMs of Q of length >= min_len, by increasing offset.
+	 * The BWT interval of each MEM is computed with backward search.
+	 */
+	vector<mem> mems(const vector<char_type>& Q, ulint min_len = 1) const {
+
+		auto MS = lengths(Q);
+
+		vector<mem> res;
+
+		for(ulint i=0;i<MS.size();++i){
+
+			if(MS[i] < std::max<ulint>(min_len,1) or (i > 0 and MS[i-1] > MS[i])) continue;
+
+			vector<char_type> P(Q.begin()+i, Q.begin()+i+MS[i]);
+			res.push_back(mem(i, MS[i], B.count(P)));
+
+		}
+
+		return res;
+
+	}
+
+	/*
+	 * batch versions: one result per query. With OpenMP, queries
+	 * are processed in parallel (the index is only read)
+	 */
+	vector<vector<ulint> > lengths(const vector<vector<char_type> >& queries) const {
+
+		vector<vector<ulint> > res(queries.size());
+
+		#pragma omp parallel for schedule(dynamic)
+		for(ulint j=0;j<queries.size();++j) res[j] = lengths(queries[j]);
+
+		return res;
+
+	}
+
+	vector<vector<mem> > mems(const vector<vector<char_type> >& queries, ulint min_len = 1) const {
+
+		vector<vector<mem> > res(queries.size());
+
+		#pragma omp parallel for schedule(dynamic)
+		for(ulint j=0;j<queries.size();++j) res[j] = mems(queries[j], min_len);
+
+		return res;
+
+	}
+
+private:
+
+	/*
+	 * length of the longest common prefix (at most cap) between the
+	 * suffix in row r and Q[i..]
+	 */
+	ulint lce(ulint r, const vector<char_type>& Q, ulint i, ulint cap) const {
+
+		ulint k = 0;
+
+		while(k < cap and B.F_at(r) == Q[i+k]){
+
+			r = B.FL(r);
+			k++;
+
+		}
+
+		return k;
+
+	}
+
+	const dyn_bwt& B;
+
+};
+
+}
+
+#endif /* MATCHING_STATISTICS_H_ */
@@ -0,0 +1,145 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * parallel_bwt.hpp
+ *
+ *  Parallel construction of the BWT of a file, i.e. of the BWT obtained
+ *  extending an empty BWT with the characters of the file in order (the BWT
+ *  of the reversed file). The file is split in chunks whose BWTs are built
+ *  concurrently. Adjacent chunks are then merged pairwise with
+ *  bwt::concatenate, the merges of each round running concurrently; the
+ *  characters of the later chunk of each pair are read again from the file.
+ *  The result is the same BWT of the sequential construction.
+ *
+ *  A merge costs one LF on the earlier BWT per character of the later one
+ *  (plus the time to write the runs of both), about half the cost of
+ *  extending. The last merge processes half of the text, hence the
+ *  construction takes at least ~1/2 of the sequential time; the chunk BWTs
+ *  together take more space than the final one.
+ *
+ *  Threads are used only if the library is compiled with OpenMP
+ *  (cmake -DXXSDS_DYN_MULTI_THREADED=ON); otherwise the chunks are
+ *  processed one after the other.
+ *
+ */
+
+#ifndef INCLUDE_ALGORITHMS_PARALLEL_BWT_HPP_
+#define INCLUDE_ALGORITHMS_PARALLEL_BWT_HPP_
+
+#include "dynamic/internal/includes.hpp"
+#include "dynamic/internal/input_reader.hpp"
+
+namespace dyn{
+
+/*
+ * bwt: an empty BWT. The chunks are built on copies of it (hence with the
+ * same alphabet encoding); on return it contains the BWT of the file.
+ * path: the input file. threads: maximum number of threads.
+ * chunks: number of chunks (0 = one per thread)
+ *
+ * returns the number of characters read from the file
+ */
+template<class bwt_type>
+ulint build_bwt_by_chunks(bwt_type& bwt, string path, ulint threads, ulint chunks = 0, bool verbose = false){
+
+	assert(bwt.bwt_length()==1);
+	assert(threads>0);
+
+	using char_type = typename bwt_type::char_type;
+
+	ulint n = 0;
+
+	{
+		std::ifstream in(path, ios::binary | ios::ate);
+		assert(in.is_open());
+		n = in.tellg();
+	}
+
+	if(n == 0) return 0;
+
+	if(chunks == 0) chunks = threads;
+	chunks = std::min(chunks, n);
+
+	//file characters [begin[i], begin[i+1]) are in BWT[i]
+	vector<ulint> begin;
+	for(ulint i=0;i<=chunks;++i) begin.push_back((n/chunks)*i + std::min(i, n%chunks));
+
+	const bwt_type empty = bwt;
+	vector<bwt_type> BWT(chunks, empty);
+
+	if(verbose) cout << "Building the RLBWTs of " << chunks << " chunks ..." << endl;
+
+	#pragma omp parallel for num_threads(threads) schedule(dynamic)
+	for(ulint i=0;i<chunks;++i){
+
+		std::ifstream in(path, ios::binary);
+		in.seekg(begin[i]);
+
+		input_reader reader(in);
+
+		char c;
+		for(ulint j=begin[i];j<begin[i+1] and reader.get(c);++j) BWT[i].extend(uchar(c));
+
+	}
+
+	while(BWT.size() > 1){
+
+		ulint pairs = BWT.size()/2;
+
+		if(verbose) cout << "Merging " << BWT.size() << " RLBWTs ..." << endl;
+
+		#pragma omp parallel for num_threads(threads) schedule(dynamic)
+		for(ulint i=0;i<pairs;++i){
+
+			std::ifstream in(path, ios::binary);
+			in.seekg(begin[2*i+1]);
+
+			input_reader reader(in);
+
+			bwt_type M = empty;
+
+			M.concatenate(BWT[2*i], BWT[2*i+1], [&]() -> char_type {
+
+				char c = 0;
+				bool ok = reader.get(c);
+
+				assert(ok);
+				(void)ok;
+
+				return uchar(c);
+
+			});
+
+			BWT[2*i] = std::move(M);
+			BWT[2*i+1] = empty;
+
+		}
+
+		//BWT[2i] now covers the chunks of BWT[2i] and BWT[2i+1]
+		ulint k = 0;
+
+		for(ulint i=0;i<BWT.size();i+=2){
+
+			if(k < i) BWT[k] = std::move(BWT[i]);
+			begin[k++] = begin[i];
+
+		}
+
+		begin[k] = n;
+
+		BWT.resize(k);
+		begin.resize(k+1);
+
+	}
+
+	bwt = std::move(BWT[0]);
+
+	return n;
+
+}
+
+}
+
+#endif /* INCLUDE_ALGORITHMS_PARALLEL_BWT_HPP_ */
@@ -0,0 +1,376 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * rle_lpf.hpp
+ *
+ *  Compute the longest previous factor (LPF) array in run-compressed space
+ *  using a dynamic run-length encoded BWT: for each text position i,
+ *  LPF[i] is the length of the longest prefix of T[i..] that occurs in a
+ *  previous position src < i (the occurrence may overlap T[i..]).
+ *
+ *  The text is scanned left to right keeping the longest suffix T[s..k)
+ *  of the scanned text that occurs ending before k (the matching statistics
+ *  of the text against its past), with one BWT row instead of the interval
+ *  (see matching_statistics.hpp). When the match start moves from s to
+ *  s' > s, LPF[s..s') are known: T[i..k) is the longest previous factor
+ *  for s <= i < s'. These positions form a group sharing the source row,
+ *  which is marked in the RLBWT (see rle_bwt::mark) and converted to a
+ *  text position at the end, with a scan of the BWT (as in rle_lz77_v2).
+ *
+ *  Space is O(R log n + g log n) bits, g being the number of groups (the
+ *  times the match is shortened). The output has one entry per text
+ *  position:
+ *
+ *   - raw coding: <src,LPF[i]> as two ulint (src = 0 if LPF[i] = 0)
+ *   - varint/gamma/delta: LPF[i] and, if LPF[i] > 0, the distance i-src,
+ *     coded as in lz77_format.hpp (gamma/delta code LPF[i]+1). The
+ *     codes of all positions form a single stream, without header
+ *
+ *  Type of input text here is uchar
+ *
+ */
+
+#ifndef INCLUDE_ALGORITHMS_RLE_LPF_HPP_
+#define INCLUDE_ALGORITHMS_RLE_LPF_HPP_
+
+#include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+
+namespace dyn{
+
+class rle_lpf{
+
+public:
+
+	using char_t = rle_bwt::char_type;
+
+	/*
+	 * Constructor #1: run-heads are gamma-coded
+	 */
+	rle_lpf(){}
+
+	/*
+	 * Constructor #2
+	 *
+	 * We know only alphabet size. Each Run-head char is assigned log2(sigma) bits.
+	 * Characters are assigned codes 0,1,2,... in order of appearance
+	 *
+	 */
+	rle_lpf(uint64_t sigma){
+
+		assert(sigma>0);
+		RLBWT = rle_bwt(sigma);
+
+	}
+
+	/*
+	 * Constructor #3
+	 *
+	 * The constructor scans the input once and computes
+	 * characters probabilities, used to Huffman-encode run heads
+	 * (see rle_lz77_v2).
+	 *
+	 */
+	rle_lpf(istream& in){
+
+		auto freqs = get_frequencies(in);
+		RLBWT = rle_bwt(freqs);
+
+	}
+
+	/*
+	 * input: an input stream and an output stream
+	 * the algorithms scans the input (just 1 scan) and
+	 * saves to the output the LPF array with the given coding
+	 * (see above)
+	 */
+	void parse(istream& in, ostream& out, lz77_coding coding = lz77_coding::raw, bool verbose = false){
+
+		ulint step = 1000000;	//print status every step characters
+		ulint last_step = 0;
+
+		/* STEP 1: compute LPF lengths and source rows */
+
+		if(verbose) cout << "Computing LPF and building RLBWT ..." << endl;
+
+		ulint s = 0;	/* T[s..k) is the longest match ending at k */
+		ulint l = 0;	/* l = k-s */
+		ulint q = 0;	/* BWT row whose suffix starts with the (reversed) match */
+
+		ulint k = 0;	/* text position */
+
+		input_reader reader(in);
+
+		char cc;
+		while(reader.get(cc)){
+
+			auto c = uchar(cc);
+
+			if(verbose and k > last_step+(step-1)){
+
+				last_step = k;
+				cout << " " << k << " characters processed ..." << endl;
+
+			}
+
+			ulint l1 = 0;
+			ulint q1 = 0;
+
+			if(l > 0 and RLBWT.at(q) == c){
+
+				l1 = l+1;
+				q1 = RLBWT.LF(q);
+
+			}else{
+
+				//the F block of c (empty if c does not occur)
+				auto block = RLBWT.LF({0,RLBWT.bwt_length()},c);
+
+				if(block.second <= block.first){
+
+					l1 = 0;
+
+				}else if(l == 0){
+
+					l1 = 1;
+					q1 = block.first;
+
+				}else{
+
+					//rows after LF of the closest c above q and of the closest c below q
+					ulint r = RLBWT.LF(q,c);
+
+					ulint best = 0;
+					ulint best_row = r < block.second ? r : r-1;
+
+					if(r > block.first){
+
+						ulint h = lce(RLBWT.FL(r-1), q, l);
+						if(h >= best){ best = h; best_row = r-1; }
+
+					}
+
+					if(r < block.second and best < l){
+
+						ulint h = lce(RLBWT.FL(r), q, l);
+						if(h > best){ best = h; best_row = r; }
+
+					}
+
+					l1 = best+1;
+					q1 = best_row;
+
+				}
+
+			}
+
+			/* the match start moves to k+1-l1: LPF[s..k+1-l1) are known */
+			if(k+1-l1 > s) close_group(s, k+1-l1-s, k, q);
+
+			RLBWT.extend(c);
+
+			/* rows after the new terminator are shifted by one */
+			if(l1 > 0 and q1 >= RLBWT.get_terminator_position()) q1++;
+
+			s = k+1-l1;
+			l = l1;
+			q = q1;
+
+			k++;
+
+		}
+
+		ulint n = k;
+
+		if(n > s) close_group(s, n-s, n, q);
+
+		/* STEP 2 : convert source rows to text positions (end of the source) */
+
+		if(verbose) cout << "Converting BWT coordinates to text coordinates ..." << endl;
+
+		for(ulint g=0;g<group_len.size();++g) group_e.push_back(0);
+
+		ulint j = 0; /* position on text */
+		ulint r = RLBWT.LF(0); /* BWT row of the prefix T[0..j] */
+
+		while(j<n){
+
+			if(RLBWT.marked(r)) group_e.increment(RLBWT.mark_value(r), j);
+
+			j++;
+			r = RLBWT.LF(r);
+
+		}
+
+		/* STEP 3 : output LPF */
+
+		if(verbose) cout << "Writing LPF ..." << endl;
+
+		vector<uint8_t> buf;
+		uint64_t acc = 0;
+		ulint bits = 0;
+
+		ulint i = 0;
+		ulint sum = 0;
+
+		for(ulint g=0;g<group_len.size();++g){
+
+			ulint end = group_end[g];
+			ulint e = group_e[group_src[g]];
+
+			for(ulint t=0;t<group_len[g];++t,++i){
+
+				/* T[i..end) occurs ending at e */
+				ulint len = end-i;
+				ulint src = len == 0 ? 0 : e+1-len;
+
+				assert(len == 0 or src < i);
+
+				sum += len;
+
+				switch(coding){
+
+					case lz77_coding::raw :
+
+						out.write((char*)&src,sizeof(ulint));
+						out.write((char*)&len,sizeof(ulint));
+
+					break;
+
+					case lz77_coding::varint :
+
+						lz77_codes::write_varint(buf, len);
+						if(len > 0) lz77_codes::write_varint(buf, i-src);
+
+					break;
+
+					case lz77_coding::gamma :
+
+						lz77_codes::write_gamma(buf, acc, bits, len+1);
+						if(len > 0) lz77_codes::write_gamma(buf, acc, bits, i-src);
+
+					break;
+
+					case lz77_coding::delta :
+
+						lz77_codes::write_delta(buf, acc, bits, len+1);
+						if(len > 0) lz77_codes::write_delta(buf, acc, bits, i-src);
+
+					break;
+
+				}
+
+				if(buf.size() >= BUFFER_SIZE){
+
+					out.write((char*)buf.data(), buf.size());
+					buf.clear();
+
+				}
+
+			}
+
+		}
+
+		assert(i == n);
+
+		lz77_codes::flush_bits(buf, acc, bits);
+		out.write((char*)buf.data(), buf.size());
+		out.flush();
+
+		if(verbose){
+
+			cout << "Done. Number of groups: " << group_len.size() << endl;
+			cout << "Average LPF: " << (n == 0 ? 0 : double(sum)/double(n)) << endl;
+
+		}
+
+	}
+
+	/*
+	 * Total number of bits allocated in RAM for this structure
+	 *
+	 * WARNING: this measure is good only for relatively small alphabets (e.g. ASCII)
+	 * (see rle_lz77_v2)
+	 */
+	ulint bit_size(){
+
+		ulint size = sizeof(rle_lpf)*8;
+
+		size += RLBWT.bit_size();
+		size += group_len.bit_size();
+		size += group_end.bit_size();
+		size += group_src.bit_size();
+		size += group_e.bit_size();
+
+		return size;
+
+	}
+
+private:
+
+	static const ulint BUFFER_SIZE = 1<<16;
+
+	/*
+	 * positions i = s, ..., s+len-1 have LPF[i] = k-i: T[i..k) occurs
+	 * in the (reversed) suffix of row q. Row q is marked with the group
+	 * number, or already marked by the first group using it
+	 */
+	void close_group(ulint s, ulint len, ulint k, ulint q){
+
+		ulint g = group_len.size();
+		ulint src = g;
+
+		/* if s = k, the group is the single position k with LPF[k] = 0 */
+		if(s < k){
+
+			if(RLBWT.marked(q)) src = RLBWT.mark_value(q);
+			else RLBWT.mark(q, g);
+
+		}
+
+		group_len.push_back(len);
+		group_end.push_back(k);
+		group_src.push_back(src);
+
+	}
+
+	/*
+	 * length of the longest common prefix (at most cap) between the
+	 * suffixes in rows r and q
+	 */
+	ulint lce(ulint r, ulint q, ulint cap) const {
+
+		ulint h = 0;
+
+		while(h < cap and RLBWT.F_at(r) == RLBWT.F_at(q)){
+
+			r = RLBWT.FL(r);
+			q = RLBWT.FL(q);
+			h++;
+
+		}
+
+		return h;
+
+	}
+
+	//the run-length encoded BWT. Source rows are marked with their group
+	rle_bwt RLBWT;
+
+	/*
+	 * group g has group_len[g] consecutive text positions i (following
+	 * those of group g-1), with LPF[i] = group_end[g]-i. Their sources end
+	 * at text position group_e[group_src[g]] (computed in step 2)
+	 */
+	packed_vector group_len;
+	packed_vector group_end;
+	packed_vector group_src;
+	packed_vector group_e;
+
+};
+
+}
+
+#endif /* INCLUDE_ALGORITHMS_RLE_LPF_HPP_ */
@@ -16,7 +16,9 @@
  *  the big-O notation is quite high: space is around 6Rlog n bits.
  *  See the algorithm rle_lz77_v2 for a more space-efficient parse.
  *
- *  Type of input text here is uchar
+ *  Type of input text here is uchar, or wide symbols of 2, 4 or 8 bytes
+ *  (see constructor #3): the trailing characters are then written on
+ *  as many bytes (see lz77_format.hpp)
  *
  *  From the paper: Alberto Policriti and Nicola Prezza, "Computing LZ77 in Run-Compressed Space"
  *
@@ -27,6 +29,9 @@
 #define INCLUDE_ALGORITHMS_rle_lz77_V1_HPP_
 
 #include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+#include "dynamic/algorithms/checkpoint.hpp"
+#include "dynamic/algorithms/parallel_bwt.hpp"
 
 namespace dyn{
 
@@ -66,10 +71,13 @@ public:
 	 *
 	 * Here Run-heads are Huffman encoded.
 	 *
+	 * symbol_bytes: the input is a stream of little-endian symbols of
+	 * symbol_bytes bytes (1, 2, 4 or 8) instead of characters
+	 *
 	 */
-	rle_lz77_v1(istream& in){
+	rle_lz77_v1(istream& in, ulint symbol_bytes = 1) : symbol_bytes(symbol_bytes){
 
-		auto freqs = get_frequencies(in);
+		auto freqs = get_frequencies(in, symbol_bytes);
 		RLBWT = rle_bwt(freqs);
 
 	}
@@ -84,14 +92,23 @@ public:
 		 * Step 1: build dynamic RLBWT of reverse stream
 		 */
 
+		//resumed after the construction of the RLBWT
+		if(state.phase > 0) return;
+
 		{
 
-			ulint j = 0;
+			//saved by the checkpoints. When resuming, skip the processed characters
+			ulint& j = state.bytes;
+
+			checkpoint::skip_input(in, j*symbol_bytes);
+			ckpt.set_next(j);
 
 			if(verbose) cout << "Building RLBWT ..." << endl;
 
-			char c;
-			while(in.get(c)){
+			input_reader reader(in);
+
+			ulint c;
+			while(reader.get_symbol(c, symbol_bytes)){
 
 				if(verbose){
 
@@ -104,14 +121,46 @@ public:
 
 				}
 
-				RLBWT.extend( uchar(c) );
+				RLBWT.extend( c );
 
 				j++;
 
+				if(ckpt.due(j)) save_checkpoint();
+
 			}
 
 		}
 
+		//bwt_to_lz77 can restart from here
+		if(ckpt.enabled()) save_checkpoint();
+
+	}
+
+	/*
+	 * as build_bwt(istream&), building the RLBWT of the file at path by
+	 * chunks with the given number of threads (see parallel_bwt.hpp).
+	 * No checkpoints are saved during the construction. A construction
+	 * resumed from a checkpoint, or of wide symbols, goes on sequentially. parse(istream&) called
+	 * afterwards on the same file finds the RLBWT built and goes on with
+	 * bwt_to_lz77.
+	 */
+	void build_bwt(string path, ulint threads, bool verbose = false){
+
+		if(state.phase > 0) return;
+
+		if(state.bytes > 0 or symbol_bytes > 1){
+
+			std::ifstream in(path);
+			build_bwt(in,verbose);
+			return;
+
+		}
+
+		if(verbose) cout << "Building RLBWT with " << threads << " threads ..." << endl;
+
+		//all the input is processed
+		state.bytes = build_bwt_by_chunks(RLBWT, path, threads, 0, verbose);
+
 	}
 
 	/*
@@ -138,7 +187,8 @@ public:
 	 * saves to the output stream (could be a file) a series
 	 * of triples <pos,len,c> of type <ulint,ulint,uchar>. Types
 	 * are converted to char* before streaming them to out
-	 * (i.e. ulint to 8 bytes and uchar to 1 byte)
+	 * (i.e. ulint to 8 bytes and uchar to 1 byte, or c to
+	 * symbol_bytes bytes for wide symbols)
 	 *
 	 * after a phrase, skip 'skip' characters before opening a
 	 * new phrase. if skip>1, third element in the output triples is
@@ -156,6 +206,17 @@ public:
 
 	}
 
+	/*
+	 * as above, but the triples are written with the given encoder
+	 * (see lz77_format.hpp). skip>1 requires raw coding
+	 */
+	void parse(istream& in, lz77_encoder& out, ulint skip = 1, bool verbose = false){
+
+		build_bwt(in,verbose);
+		bwt_to_lz77(out,skip,verbose);
+
+	}
+
 	/*
 	 * input: an output stream. Note that the RLBWT must have been
 	 * built before calling this procedure.
@@ -163,7 +224,8 @@ public:
 	 * saved to the output stream (could be a file) as a series
 	 * of triples <pos,len,c> of type <ulint,ulint,uchar>. Types
 	 * are converted to char* before streaming them to out
-	 * (i.e. ulint to 8 bytes and uchar to 1 byte)
+	 * (i.e. ulint to 8 bytes and uchar to 1 byte, or c to
+	 * symbol_bytes bytes for wide symbols)
 	 *
 	 * after a phrase, skip 'skip' characters before opening a
 	 * new phrase. if skip>1, third element in the output triples is
@@ -176,9 +238,16 @@ public:
 	 */
 	void bwt_to_lz77(ostream& out, ulint skip = 1, bool verbose = false){
 
-		assert(skip>0);
+		lz77_encoder enc(out, lz77_coding::raw, symbol_bytes);
+		bwt_to_lz77(enc,skip,verbose);
+
+	}
+
+	void bwt_to_lz77(lz77_encoder& out, ulint skip = 1, bool verbose = false){
 
-		ulint z = 0;//number of phrases
+		assert(skip>0);
+		assert(skip==1 or out.get_coding()==lz77_coding::raw);
+		assert(out.character_bytes()==symbol_bytes);
 
 		long int step = 1000000;	//print status every step characters
 		long int last_step = 0;
@@ -186,47 +255,68 @@ public:
 		//RLBWT must have been built
 		assert(RLBWT.size()>1);
 
+		ulint n = RLBWT.size();	/* size of BWT (terminators included)  */
+
 		/*
-		 * initialize variables
+		 * the parse variables are saved by the checkpoints (see parse_state)
 		 */
 
-		ulint n = RLBWT.size();	/* size of BWT (terminators included)  */
+		ulint& z = state.z;	/* number of phrases */
 
 		/* last position (on text) of current LZ phrase prefix.
 		 * at the beginning, j=1: we ignore the BWT terminator
 		 */
-		ulint j = 1;
+		ulint& j = state.j;
 
-		ulint k = 0;			/* position in RLBWT corresponding to position 1 in the text*/
+		ulint& k = state.k;		/* position in RLBWT corresponding to position j in the text*/
 
-		ulint l = 0;			/* Length of current LZ phrase prefix */
-		ulint p = 0;			/* Previous occurrence of current LZ phrase prefix.
+		ulint& l = state.l;		/* Length of current LZ phrase prefix */
+		ulint& p = state.p;		/* Previous occurrence of current LZ phrase prefix.
 								 * Value 0 is undefined (NULL) since no phrase can
 								 * start at position 0 (because position 0 on the text
 								 * contains the BWT terminator.
 								 */
 
-		{
+		char_t& c = state.c;	/* current T character */
 
-			//initialize Suffix array samples
+		pair<ulint, ulint>& range = state.range;	/* range of current LZ phrase prefix
+													 * full interval is <0,n> : intervals
+													 * are of the form [l,r)
+													 */
 
-			auto A = RLBWT.get_alphabet();	//get alphabet
+		if(state.phase == 0){
+
+			/*
+			 * initialize variables
+			 */
 
 			//for each character, create a sparse vector of SA samples
-			for(auto c : A){
+			for(auto a : RLBWT.get_alphabet()){
 
-				SA[c] = sparse_vec(n);
+				SA[a] = sparse_vec(n);
 
 			}
 
-		}
+			state.phase = 1;
+
+			z = 0;
+			j = 1;
+			k = 0;
+			l = 0;
+			p = 0;
+			c = RLBWT[k];
+			range = {0,n};
 
-		char_t c = RLBWT[k];	/* current T character */
+		}else if(not enc_state.empty()){
+
+			//resumed: restore the output
+			std::istringstream es(enc_state);
+			out.load(es);
+			enc_state.clear();
+
+		}
 
-		pair<ulint, ulint> range = {0,n};	/* range of current LZ phrase prefix
-											 * full interval is <0,n> : intervals
-											 * are of the form [l,r)
-											 */
+		ckpt.set_next(j);
 
 		step = 5;
 		last_step = -step;
@@ -275,21 +365,12 @@ public:
 
 			}else{
 
-				auto start = (char*)(new ulint(l==0 ? 0 : p-1));
-				auto len = (char*)(new ulint(l));
-
 				assert(c!=RLBWT.get_terminator());
-				auto cc = (char)c;
 
-				out.write(start,sizeof(ulint));
-				out.write(len,sizeof(ulint));
-				out.write(&cc,1);
+				out.add(l==0 ? 0 : p-1, l, c);
 
 				z++;
 
-				delete start;
-				delete len;
-
 				l = 0;
 				p = 0;
 				range = {0,n};
@@ -307,12 +388,70 @@ public:
 
 			}
 
+			if(ckpt.due(j)) save_checkpoint(&out);
+
 		}
 
+		out.close();
+
 		if(verbose) cout << "Done. Number of phrases: " << z << endl;
 
 	}
 
+	/*
+	 * during build_bwt and bwt_to_lz77, save the state to path every rate
+	 * input characters (and after building the RLBWT)
+	 */
+	void set_checkpoint(string path, ulint rate){
+
+		ckpt = checkpoint(path, rate);
+
+	}
+
+	/*
+	 * load the state saved in a checkpoint file. The next call to parse
+	 * (or to build_bwt and bwt_to_lz77), on the same input and with an
+	 * encoder on the same output file (opened without truncating it),
+	 * continues from where the checkpoint was saved
+	 */
+	void resume(string path){
+
+		std::ifstream in(path, ios::binary);
+
+		RLBWT = rle_bwt();
+		RLBWT.load(in);
+
+		state.phase = checkpoint::read_word(in);
+		state.bytes = checkpoint::read_word(in);
+		symbol_bytes = checkpoint::read_word(in);
+
+		if(state.phase == 0) return;
+
+		state.z = checkpoint::read_word(in);
+		state.j = checkpoint::read_word(in);
+		state.k = checkpoint::read_word(in);
+		state.l = checkpoint::read_word(in);
+		state.p = checkpoint::read_word(in);
+		state.c = checkpoint::read_word(in);
+		state.range.first = checkpoint::read_word(in);
+		state.range.second = checkpoint::read_word(in);
+
+		SA.clear();
+
+		ulint sigma = checkpoint::read_word(in);
+
+		for(ulint i=0;i<sigma;++i){
+
+			char_t a = checkpoint::read_word(in);
+			SA[a].load(in);
+
+		}
+
+		//the rest is the encoder state, loaded by bwt_to_lz77
+		enc_state = string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	}
+
 	/*
 	 * Total number of bits allocated in RAM for this structure
 	 *
@@ -336,6 +475,57 @@ public:
 
 private:
 
+	/*
+	 * variables of build_bwt (phase 0) and bwt_to_lz77 (phase 1)
+	 */
+	struct parse_state{
+
+		ulint phase = 0;
+		ulint bytes = 0;	//input characters processed in phase 0
+
+		ulint z = 0;
+		ulint j = 1;
+		ulint k = 0;
+		ulint l = 0;
+		ulint p = 0;
+		char_t c = 0;
+		pair<ulint, ulint> range = {0,0};
+
+	};
+
+	/*
+	 * out: the encoder of bwt_to_lz77 (phase 1 only)
+	 */
+	void save_checkpoint(lz77_encoder* out = nullptr){
+
+		ckpt.save(state.phase == 0 ? state.bytes : state.j, [this,out](ostream& o){
+
+			RLBWT.serialize(o);
+
+			checkpoint::write_word(o, state.phase);
+			checkpoint::write_word(o, state.bytes);
+			checkpoint::write_word(o, symbol_bytes);
+
+			if(state.phase == 0) return;
+
+			for(auto x : {state.z, state.j, state.k, state.l, state.p, ulint(state.c), state.range.first, state.range.second})
+				checkpoint::write_word(o, x);
+
+			checkpoint::write_word(o, SA.size());
+
+			for(auto& e : SA){
+
+				checkpoint::write_word(o, e.first);
+				e.second.serialize(o);
+
+			}
+
+			out->serialize(o);
+
+		});
+
+	}
+
 	//the run-length encoded BWT
 	rle_bwt RLBWT;
 
@@ -343,6 +533,15 @@ private:
 	//one (sparse) vector of samples per character
     tsl::hopscotch_map<char_t,sparse_vec> SA;
 
+	parse_state state;
+	checkpoint ckpt;
+
+	//encoder state read by resume
+	string enc_state;
+
+	//bytes per input symbol
+	ulint symbol_bytes = 1;
+
 };
 
 }
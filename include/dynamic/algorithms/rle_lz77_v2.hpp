@@ -12,11 +12,23 @@
  *  using a dynamic run-length encoded BWT with
  *  a sparse SA sampling (1 sample per LZ factor).
  *
+ *  The sampled BWT positions are marks in the RLBWT (see rle_bwt::mark),
+ *  whose values are the samples: they move with the insertions, hence
+ *  extending the BWT with a character does not update the samples. Only
+ *  the factors update them.
+ *
+ *  With a window (set_window), the RLBWT keeps only the last characters of
+ *  the input (bwt::shrink). When the row of a sample leaves the window,
+ *  its text position is known and the factors using it are resolved. The
+ *  factor arrays still take O(z log n) bits.
+ *
  *  Space is O(R log n + z log n) bits. The constants hidden in the
  *  big-O notation are much smaller than in rle_lz77_v1.hpp:
  *  in this algorithm, space usage is around (2R + 3z) log n bits
  *
- *  Type of input text here is uchar
+ *  Type of input text here is uchar, or wide symbols of 2, 4 or 8 bytes
+ *  (see constructor #3): the trailing characters are then written on
+ *  as many bytes (see lz77_format.hpp)
  *
  *
  */
@@ -25,6 +37,8 @@
 #define INCLUDE_ALGORITHMS_RLE_LZ77_V2_HPP_
 
 #include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+#include "dynamic/algorithms/checkpoint.hpp"
 #include <unordered_map>
 
 namespace dyn{
@@ -65,10 +79,13 @@ public:
 	 *
 	 * Here Run-heads are Huffman encoded.
 	 *
+	 * symbol_bytes: the input is a stream of little-endian symbols of
+	 * symbol_bytes bytes (1, 2, 4 or 8) instead of characters
+	 *
 	 */
-	rle_lz77_v2(istream& in){
+	rle_lz77_v2(istream& in, ulint symbol_bytes = 1) : symbol_bytes(symbol_bytes){
 
-		auto freqs = get_frequencies(in);
+		auto freqs = get_frequencies(in, symbol_bytes);
 		RLBWT = rle_bwt(freqs);
 
 	}
@@ -79,7 +96,8 @@ public:
 	 * saves to the output (could be a file) a series
 	 * of triples <pos,len,c> of type <ulint,ulint,uchar>. Types
 	 * are converted to char* before streaming them to out
-	 * (i.e. ulint to 8 bytes and uchar to 1 byte)
+	 * (i.e. ulint to 8 bytes and uchar to 1 byte, or c to
+	 * symbol_bytes bytes for wide symbols)
 	 *
 	 * to get also the last factor, input stream should
 	 * terminate with a character that does not appear elsewhere
@@ -88,31 +106,42 @@ public:
 	 */
 	void parse(istream& in, ostream& out, bool verbose = false){
 
-		long int step = 1000000;	//print status every step characters
-		long int last_step = 0;
+		lz77_encoder enc(out, lz77_coding::raw, symbol_bytes);
+		parse(in, enc, verbose);
 
-		ulint pos = 0;			/* text characters processed */
+	}
 
-		ulint l = 0;			/* Length of current LZ phrase prefix */
+	/*
+	 * as above, but the triples are written with the given encoder
+	 * (see lz77_format.hpp), whose characters take symbol_bytes bytes
+	 */
+	void parse(istream& in, lz77_encoder& out, bool verbose = false){
 
-		ulint z = 0;			/* LZ phrase counter */
+		assert(out.character_bytes() == symbol_bytes);
 
-		pair<ulint, ulint> range = {0,1};	/* range of current LZ phrase prefix
-											 * full interval is <0,n> : intervals
-											 * are of the form [l,r). At the beginning,
-											 * only BWT terminator is in the BWT
-											 */
+		long int step = 1000000;	//print status every step characters
+		long int last_step = 0;
+
+		/* the state of step 1 is saved by the checkpoints (see parse_state) */
+		ulint& pos = state.pos;
+		ulint& l = state.l;
+		ulint& z = state.z;
+		pair<ulint, ulint>& range = state.range;
 
 		/* STEP 1: parse input and store LZ-factors start positions in BWT-coordinate space */
 
 		if(verbose) cout << "Parsing input and building RLBWT ..." << endl;
 
-		SA.insert_NIL(0);	/* at the beginning, RLBWT contains only the terminator */
+		/* when resuming, skip the characters processed before the checkpoint */
+		checkpoint::skip_input(in, pos*symbol_bytes);
+		ckpt.set_next(pos);
+
+		if(verbose and pos > 0) cout << " resuming after " << pos << " characters ..." << endl;
 
-		char cc;
-		while(in.get(cc)){
+		input_reader reader(in);
 
-			auto c = uchar(cc);
+		ulint c;
+		while(reader.get_symbol(c, symbol_bytes)){
 
 			if(verbose){
 
@@ -137,22 +166,28 @@ public:
 
 				factors_char.push_back( c );
 				factors_len.push_back( l );
+				factors_start.push_back( 0 );
 
 				if(l>0){
 
-					/*j = start position of LZ factor, but in BWT coordinate-space */
-					auto j = range_temp.first;
-
-					auto SA_j = SA[j];
+					/*
+					 * j = start position of LZ factor, but in BWT coordinate-space.
+					 * The range contains also the current suffix (the terminator
+					 * row), which is not a valid source
+					 */
+					auto j = range_temp.first == RLBWT.get_terminator_position() ?
+								range_temp.second-1 :
+								range_temp.first;
 
-					if(SA_j == SA.get_NIL()){
+					if(not RLBWT.marked(j)){
 
 						/* no sample here. Insert a new sample */
 
-						/* SA[j] points to the last bit set (appended with
-						 * the next instruction) in rep */
+						/* the sample of j points to the last bit set
+						 * (appended with the next instruction) in rep */
 						auto r = rep.rank1(rep.size());
-						SA[j] = r;
+
+						RLBWT.mark(j, r);
 
 						/* append bit set in rep */
 						rep.push_back(true);
@@ -164,8 +199,8 @@ public:
 
 						/* this position is already marked (i.e. used by a LZ factor). */
 
-						/* SA[j]=t refers to the t-th bit set in rep*/
-						auto k = rep.select1(SA_j);
+						/* sample t of j refers to the t-th bit set in rep*/
+						auto k = rep.select1(RLBWT.mark_value(j));
 
 						/* insert a 0 in rep */
 						rep.insert0(k);
@@ -177,6 +212,8 @@ public:
 
 				}
 
+				slide_window();
+
 				/* reset range. Add 1 to right border because we still have to insert c */
 				range = {0,RLBWT.size()+1};
 
@@ -194,23 +231,23 @@ public:
 			}
 
 			RLBWT.extend( c );
-			SA.insert_NIL(RLBWT.get_terminator_position());
 
 			pos++;
 
+			if(ckpt.due(pos)) save_checkpoint();
+
 		}
 
+		/* steps 2 and 3 can restart from here */
+		if(ckpt.enabled()) save_checkpoint();
+
 		/* STEP 2 : convert LZ factors start coordinates from BWT-coordinate space to text-coordinate space*/
 
 		if(verbose) cout << "Converting BWT coordinates to text coordinates ..." << endl;
 
-		ulint n = RLBWT.size()-1; /* text length */
-
-		ulint width = 64 - __builtin_popcountll( n );	/* number of bits to store a text address */
-
-		factors_start = packed_vector(z,width);
+		ulint n = RLBWT.size()-1+state.removed; /* text length */
 
-		ulint j = 0; /* position on text */
+		ulint j = state.removed; /* position on text (the first in the window) */
 		ulint k = RLBWT.LF(0); /* position on F column of RLBWT corresponding to text position j*/
 
 		step = 5;
@@ -220,7 +257,7 @@ public:
 
 			if(verbose){
 
-				int perc = (100*j)/n;
+				int perc = (100*(j-state.removed))/(n-state.removed);
 				if(perc>last_step+(step-1)){
 
 					last_step = perc;
@@ -230,25 +267,7 @@ public:
 
 			}
 
-			auto r = SA[k];
-
-			if(r != SA.get_NIL()){
-
-				l = r == 0 ? 0 : rep.select1(r-1)+1;
-				r = rep.select1(r);
-
-				for(ulint i = l; i<=r;++i){
-
-					auto factor = ptr[i];
-					auto len = factors_len[factor];
-
-					assert(factor<factors_start.size());
-
-					factors_start[factor] = len == 0 ? 0 : j - (len-1);
-
-				}
-
-			}
+			if(RLBWT.marked(k)) resolve_sources(RLBWT.mark_value(k), j);
 
 			j++;
 			k = RLBWT.LF(k);
@@ -268,16 +287,11 @@ public:
 
 		for(ulint j=0;j<z;++j) {
 
-			auto start = (char*)(new ulint(factors_start[j]));
-			auto len = (char*)(new ulint(factors_len[j]));
-
 			assert(factors_char[j]!=RLBWT.get_terminator());
 
-			auto cc = (char)factors_char[j];
+			ulint cc = factors_char[j];
 
-			out.write(start,sizeof(ulint));
-			out.write(len,sizeof(ulint));
-			out.write(&cc,1);
+			out.add(factors_start[j], factors_len[j], cc);
 
 			if(factors_len[j] > 0 and cumulative < uint64_t(factors_start[j])+1){
 
@@ -294,32 +308,82 @@ public:
 
 			gamma_bits += gamma(uint64_t(backward_pos+1));
 			gamma_bits += gamma(uint64_t(uint64_t(factors_len[j])+1));
-			gamma_bits += gamma(uint64_t(uint8_t(cc)));
+			gamma_bits += gamma(uint64_t(cc));
 
 			delta_bits += delta(uint64_t(backward_pos+1));
 			delta_bits += delta(uint64_t(uint64_t(factors_len[j])+1));
-			delta_bits += delta(uint64_t(uint8_t(cc)));
+			delta_bits += delta(uint64_t(cc));
 
 			cumulative += (uint64_t(factors_len[j]) + 1);
 
-			delete start;
-			delete len;
-
 		}
 
+		out.close();
 
 		if(verbose){
 
 			cout << "Done. Number of phrases: " << z << endl;
 			cout << "Entropy of the offsets: " << entropy(off) << endl;
 			cout << "Sum of logs of the offsets: " << sum_log << endl;
-			cout << "gamma complexity of the output: " << (gamma_bits/8)+1 << " Bytes, " << double(gamma_bits)/double(RLBWT.text_length()) << " bit/symbol" << endl;
-			cout << "delta complexity of the output: " << (delta_bits/8)+1 << " Bytes, " << double(delta_bits)/double(RLBWT.text_length()) << " bit/symbol" << endl;
+			cout << "gamma complexity of the output: " << (gamma_bits/8)+1 << " Bytes, " << double(gamma_bits)/double(n) << " bit/symbol" << endl;
+			cout << "delta complexity of the output: " << (delta_bits/8)+1 << " Bytes, " << double(delta_bits)/double(n) << " bit/symbol" << endl;
 
 		}
 
 	}
 
+	/*
+	 * during parse, save the state to path every rate input characters
+	 * (and at the end of the input)
+	 */
+	void set_checkpoint(string path, ulint rate){
+
+		ckpt = checkpoint(path, rate);
+
+	}
+
+	/*
+	 * index only the last w input characters (0 = the whole input). Use
+	 * the same window when resuming from a checkpoint
+	 */
+	void set_window(ulint w){
+
+		window = w;
+
+	}
+
+	/*
+	 * load the state saved in a checkpoint file. The next call to parse,
+	 * on the same input, continues from where the checkpoint was saved
+	 */
+	void resume(string path){
+
+		std::ifstream in(path, ios::binary);
+
+		RLBWT = rle_bwt();
+		rep = suc_bv();
+		ptr = packed_spsi();
+		factors_start = packed_vector();
+		factors_len = packed_vector();
+		factors_char = packed_vector();
+
+		RLBWT.load(in);
+		rep.load(in);
+		ptr.load(in);
+		factors_start.load(in);
+		factors_len.load(in);
+		factors_char.load(in);
+
+		state.pos = checkpoint::read_word(in);
+		state.l = checkpoint::read_word(in);
+		state.z = checkpoint::read_word(in);
+		state.range.first = checkpoint::read_word(in);
+		state.range.second = checkpoint::read_word(in);
+		state.removed = checkpoint::read_word(in);
+		symbol_bytes = checkpoint::read_word(in);
+
+	}
+
 	/*
 	 * Total number of bits allocated in RAM for this structure
 	 *
@@ -334,7 +398,6 @@ public:
 		ulint size = sizeof(rle_lz77_v2)*8;
 
 		size += RLBWT.bit_size();
-		size += SA.bit_size();
 		size += rep.bit_size();
 		size += ptr.bit_size();
 
@@ -348,6 +411,94 @@ public:
 
 private:
 
+	/*
+	 * variables of step 1 of the parse
+	 */
+	struct parse_state{
+
+		ulint pos = 0;			/* text characters processed */
+
+		ulint l = 0;			/* Length of current LZ phrase prefix */
+
+		ulint z = 0;			/* LZ phrase counter */
+
+		pair<ulint, ulint> range = {0,1};	/* range of current LZ phrase prefix
+											 * full interval is <0,n> : intervals
+											 * are of the form [l,r). At the beginning,
+											 * only BWT terminator is in the BWT
+											 */
+
+		ulint removed = 0;		/* characters removed from the RLBWT (window) */
+
+	};
+
+	void save_checkpoint(){
+
+		ckpt.save(state.pos, [this](ostream& out){
+
+			RLBWT.serialize(out);
+			rep.serialize(out);
+			ptr.serialize(out);
+			factors_start.serialize(out);
+			factors_len.serialize(out);
+			factors_char.serialize(out);
+
+			checkpoint::write_word(out, state.pos);
+			checkpoint::write_word(out, state.l);
+			checkpoint::write_word(out, state.z);
+			checkpoint::write_word(out, state.range.first);
+			checkpoint::write_word(out, state.range.second);
+			checkpoint::write_word(out, state.removed);
+			checkpoint::write_word(out, symbol_bytes);
+
+		});
+
+	}
+
+	/*
+	 * the factors using the BWT position with sample t as source start at
+	 * text position j-(len-1)
+	 */
+	void resolve_sources(ulint t, ulint j){
+
+		ulint l = t == 0 ? 0 : rep.select1(t-1)+1;
+		ulint r = rep.select1(t);
+
+		for(ulint i = l; i<=r;++i){
+
+			auto factor = ptr[i];
+			auto len = factors_len[factor];
+
+			assert(factor<factors_start.size());
+			assert(factors_start[factor] == 0);
+
+			if(len > 0) factors_start.increment(factor, j - (len-1));
+
+		}
+
+	}
+
+	/*
+	 * remove the characters before the window (between two phrases). The
+	 * removed character is the text position state.removed: the samples
+	 * leaving the window are resolved
+	 */
+	void slide_window(){
+
+		while(window > 0 and RLBWT.text_length() > window){
+
+			RLBWT.shrink([this](ulint i){
+
+				if(RLBWT.marked(i)) resolve_sources(RLBWT.mark_value(i), state.removed);
+
+			}, [](ulint, ulint){});
+
+			state.removed++;
+
+		}
+
+	}
+
 	/*
 	 * number of bits required to write down x>0
 	 */
@@ -406,12 +557,11 @@ private:
 	//the run-length encoded BWT
 	rle_bwt RLBWT;
 
-	//suffix array samples. These are pointers to the bits set in rep
-	sparse_vec SA;
-
 	/*
 	 * a BWT position can be shared as source by more than 1 LZ factor.
-	 * If SA[i] != NIL, then ptr[ rep.select1( SA.rank(i) ), ..., rep.select1( SA.rank(i) +1)-1 ]
+	 * The suffix array samples are the values of the marked BWT positions
+	 * (RLBWT.mark_value), pointers to the bits set in rep:
+	 * if i is marked with sample t, then ptr[ rep.select1(t-1)+1, ..., rep.select1(t) ]
 	 * are pointers to LZ factors that share the BWT position i as source.
 	 */
 	suc_bv rep;	/* 00001 */
@@ -421,12 +571,22 @@ private:
 	 *
 	 * start, length and trailing character of each LZ factor.
 	 * Length is the length of a factor minus 1 (we do not
-	 * count the trailing character).
+	 * count the trailing character). Starts are set when
+	 * the sources leave the window, or in step 2.
 	 */
 	packed_vector factors_start;
 	packed_vector factors_len;
 	packed_vector factors_char;
 
+	parse_state state;
+	checkpoint ckpt;
+
+	//number of input characters indexed (0 = all)
+	ulint window = 0;
+
+	//bytes per input symbol
+	ulint symbol_bytes = 1;
+
 };
 
 }
@@ -0,0 +1,242 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * rle_lz_end.hpp
+ *
+ *  Compute the LZ-End parsing (Kreft and Navarro, "On compressing and
+ *  indexing repetitive sequences", TCS 2013) in run-compressed space using
+ *  a dynamic run-length encoded BWT.
+ *
+ *  Each phrase is the longest prefix of the remaining text that ends (as a
+ *  source) at the end of a previous phrase, followed by one character.
+ *  Since sources end at phrase boundaries, any suffix of a phrase can be
+ *  extracted from the parse without decoding the whole text.
+ *
+ *  The phrase ends are marks in the RLBWT (see rle_bwt::mark), whose value
+ *  is their text position: the sources are known online, there is no
+ *  second pass. The prefix of the remaining text is searched (backward
+ *  search on the BWT of the reversed text) until its range is empty; the
+ *  longest prefix whose range contains a mark is the phrase. The
+ *  characters read after the phrase are searched again for the next
+ *  phrase, hence the time is not linear in the worst case.
+ *
+ *  Space is O(R log n + z log n) bits (marks split the runs). The phrases
+ *  are written as LZ77 triples (see lz77_format.hpp): lz77_decompress
+ *  decodes them.
+ *
+ *  Type of input text here is uchar
+ *
+ */
+
+#ifndef INCLUDE_ALGORITHMS_RLE_LZ_END_HPP_
+#define INCLUDE_ALGORITHMS_RLE_LZ_END_HPP_
+
+#include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+#include <deque>
+
+namespace dyn{
+
+class rle_lz_end{
+
+public:
+
+	using char_t = rle_bwt::char_type;
+
+	/*
+	 * Constructor #1: run-heads are gamma-coded
+	 */
+	rle_lz_end(){}
+
+	/*
+	 * Constructor #2
+	 *
+	 * We know only alphabet size. Each Run-head char is assigned log2(sigma) bits.
+	 * Characters are assigned codes 0,1,2,... in order of appearance
+	 *
+	 */
+	rle_lz_end(uint64_t sigma){
+
+		assert(sigma>0);
+		RLBWT = rle_bwt(sigma);
+
+	}
+
+	/*
+	 * Constructor #3
+	 *
+	 * The constructor scans the input once and computes
+	 * characters probabilities, used to Huffman-encode run heads
+	 * (see rle_lz77_v2).
+	 *
+	 */
+	rle_lz_end(istream& in){
+
+		auto freqs = get_frequencies(in);
+		RLBWT = rle_bwt(freqs);
+
+	}
+
+	/*
+	 * input: an input stream and an output stream
+	 * the algorithms scans the input (just 1 scan) and
+	 * saves to the output the LZ-End phrases as triples
+	 * <pos,len,c> of type <ulint,ulint,uchar> (raw coding)
+	 *
+	 * the last phrase is shortened if needed, so that it has a
+	 * trailing character: the whole input is parsed
+	 *
+	 */
+	void parse(istream& in, ostream& out, bool verbose = false){
+
+		lz77_encoder enc(out, lz77_coding::raw);
+		parse(in, enc, verbose);
+
+	}
+
+	/*
+	 * as above, but the triples are written with the given encoder
+	 * (see lz77_format.hpp)
+	 */
+	void parse(istream& in, lz77_encoder& out, bool verbose = false){
+
+		ulint step = 1000000;	//print status every step characters
+		ulint last_step = 0;
+
+		if(verbose) cout << "Parsing input and building RLBWT ..." << endl;
+
+		input_reader reader(in);
+		bool eof = false;
+
+		//characters read and not yet in the RLBWT
+		std::deque<uchar> pending;
+
+		while(true){
+
+			if(verbose and n > last_step+(step-1)){
+
+				last_step = n;
+				cout << " " << n << " characters processed ..." << endl;
+
+			}
+
+			pair<ulint, ulint> range = {0,RLBWT.bwt_length()};
+
+			ulint k = 0;	//length of the searched prefix
+			ulint len = 0;	//length of the longest prefix ending at a phrase end
+			ulint e = 0;	//text position of that phrase end
+
+			//the previous (shorter) prefix ending at a phrase end
+			ulint prev_len = 0;
+			ulint prev_e = 0;
+
+			while(true){
+
+				if(k == pending.size()){
+
+					char cc;
+
+					if(eof or not reader.get(cc)){
+
+						eof = true;
+						break;
+
+					}
+
+					pending.push_back(uchar(cc));
+
+				}
+
+				range = RLBWT.LF(range, pending[k]);
+
+				if(range.second <= range.first) break;
+
+				k++;
+
+				/*
+				 * the terminator row is the whole text, which ends with
+				 * the last phrase. The other phrase ends are marked
+				 */
+				ulint t = RLBWT.get_terminator_position();
+				ulint m = RLBWT.next_mark(range.first);
+
+				if((range.first <= t and t < range.second) or m < range.second){
+
+					prev_len = len;
+					prev_e = e;
+
+					len = k;
+					e = range.first <= t and t < range.second ? n-1 : RLBWT.mark_value(m);
+
+				}
+
+			}
+
+			if(pending.size() == 0) break;
+
+			/* the input ended: the phrase needs a trailing character */
+			if(len == pending.size()){
+
+				len = prev_len;
+				e = prev_e;
+
+			}
+
+			out.add(len == 0 ? 0 : e+1-len, len, pending[len]);
+
+			/* insert the phrase in the RLBWT */
+			for(ulint i=0;i<=len;++i){
+
+				ulint t = RLBWT.get_terminator_position();
+
+				RLBWT.extend(pending.front());
+				pending.pop_front();
+
+				/* the previous phrase end is not the terminator row anymore: mark it */
+				if(i == 0 and n > 0) RLBWT.mark(t < RLBWT.get_terminator_position() ? t : t+1, n-1);
+
+			}
+
+			n += len+1;
+			z++;
+
+		}
+
+		out.close();
+
+		if(verbose){
+
+			cout << "Done. Number of phrases: " << z << endl;
+			cout << "Number of BWT runs: " << RLBWT.number_of_runs() << endl;
+
+		}
+
+	}
+
+	/*
+	 * Total number of bits allocated in RAM for this structure
+	 *
+	 * WARNING: this measure is good only for relatively small alphabets (e.g. ASCII)
+	 * (see rle_lz77_v2)
+	 */
+	ulint bit_size(){
+
+		return sizeof(rle_lz_end)*8 + RLBWT.bit_size();
+
+	}
+
+private:
+
+	//the run-length encoded BWT. Phrase ends are marked with their text position
+	rle_bwt RLBWT;
+
+	ulint n = 0;	/* characters parsed */
+	ulint z = 0;	/* number of phrases */
+
+};
+
+}
+
+#endif /* INCLUDE_ALGORITHMS_RLE_LZ_END_HPP_ */
@@ -24,7 +24,12 @@
 #include "dynamic/internal/lciv.hpp"
 #include "dynamic/internal/wt_string.hpp"
 #include "dynamic/internal/wm_string.hpp"
+#include "dynamic/internal/kary_wt_string.hpp"
 #include "dynamic/internal/fm_index.hpp"
+#include "dynamic/internal/r_index.hpp"
+#include "dynamic/internal/bidirectional_bwt.hpp"
+#include "dynamic/internal/lcp_index.hpp"
+#include "dynamic/internal/input_reader.hpp"
 
 namespace dyn{
 
@@ -63,6 +68,19 @@ typedef wt_string<suc_bv> wt_str;
  */
 typedef wm_string<succinct_bitvector<spsi<packed_bit_vector,256,16>>> wm_str;
 
+/*
+ * succinct dynamic string implemented with a 4-ary wavelet tree: each node stores
+ * 2-bit digits with per-symbol counters. One B-tree descent per operation for
+ * sigma <= 4 (e.g. DNA), two for sigma <= 16.
+ */
+typedef kary_wt_string<packed_symbol_vector<2,4096,16>> wt4_str;
+
+/*
+ * succinct dynamic string implemented with a 16-ary wavelet tree (4-bit digits).
+ * One B-tree descent per operation for sigma <= 16, two for sigma <= 256.
+ */
+typedef kary_wt_string<packed_symbol_vector<4,2048,16>> wt16_str;
+
 /*
  * run-length encoded (RLE) string. This string uses 1 sparse bitvector
  * for all runs, one dynamic string for run heads, and sigma sparse bitvectors (one per character)
@@ -87,6 +105,11 @@ typedef wt_string<gap_bv> wtgap_str;
  */
 typedef bwt<wt_str,rle_str> wt_bwt;
 
+/*
+ * succinct BWT for small alphabets (see description of wt4_str)
+ */
+typedef bwt<wt4_str,rle_str> wt4_bwt;
+
 /*
  * run-length encoded BWT
  */
@@ -107,6 +130,12 @@ typedef sparse_vector<packed_spsi,gap_bv> sparse_vec;
  */
 typedef fm_index<wt_bwt, suc_bv, packed_spsi> wt_fmi;
 
+/*
+ * dynamic succinct FM index for small alphabets (e.g. DNA): each LF step costs a
+ * single B-tree descent in the BWT. BWT positions are marked with a succinct bitvector
+ */
+typedef fm_index<wt4_bwt, suc_bv, packed_spsi> wt4_fmi;
+
 /*
  * dynamic run-length encoded FM index. BWT positions are
  * marked with a gap-encoded bitvector.
@@ -117,6 +146,35 @@ typedef fm_index<wt_bwt, suc_bv, packed_spsi> wt_fmi;
  */
 typedef fm_index<rle_bwt, gap_bv, packed_spsi> rle_fmi;
 
+/*
+ * dynamic r-index: run-length encoded FM index with SA samples at the
+ * BWT run boundaries. Locate costs O(log n) per occurrence after the first.
+ *
+ * ( 2*R*log(n/R) + R*H0 + 2*R*log(n/R) + 2*R*log n )(1+o(1)) bits of space, where
+ * R is the number of runs in the BWT
+ *
+ */
+typedef r_index<rle_bwt, gap_bv, packed_spsi> rle_rindex;
+
+/*
+ * dynamic run-length encoded FM index with an LCP array sampled at the
+ * BWT run heads: lcp(i), string depth, parent and suffix link of suffix
+ * tree nodes (BWT intervals).
+ *
+ * rle_fmi + ( R*log(n/R) + R*log n )(1+o(1)) bits of space, where
+ * R is the number of runs in the BWT
+ *
+ */
+typedef lcp_index<rle_fmi, gap_bv, packed_spsi> rle_lcp_fmi;
+
+/*
+ * dynamic bidirectional BWTs of a document collection: the BWTs of the
+ * documents and of the reversed documents are kept in sync, so that
+ * patterns can be extended both to the left and to the right
+ */
+typedef bidirectional_bwt<wt_bwt> wt_bd_bwt;
+typedef bidirectional_bwt<rle_bwt> rle_bd_bwt;
+
 
 // ------------- STRUCTURES DESIGNED ONLY FOR DEBUGGING PURPOSES -------------
 
@@ -217,6 +275,78 @@ void rle_bwt::build_from_string(string& bwt, char terminator, bool verbose){
 
 }
 
+/*
+ * select on L of all ranks in I (sorted): ranks falling in the same
+ * run of L share the select on the run heads
+ */
+template<>
+inline
+vector<ulint> rle_bwt::select_L(const vector<ulint>& I, char_type c) const {
+
+	return L.select(I,c);
+
+}
+
+/*
+ * run of L containing position i
+ */
+template<>
+inline
+pair<ulint,ulint> rle_bwt::run_of_L(ulint i) const {
+
+	return L.locate_run(i);
+
+}
+
+/*
+ * append runs to L: one insertion per run
+ */
+template<>
+inline
+void rle_bwt::push_L(const vector<pair<ulint,ulint> >& runs){
+
+	for(auto r : runs) L.insert(L.size(),r.first,r.second);
+
+}
+
+/*
+ * append characters to L with the linear-time bulk construction
+ */
+template<>
+inline
+void wt_bwt::push_L(const vector<pair<ulint,ulint> >& runs){
+
+	vector<ulint> S;
+	for(auto r : runs) S.insert(S.end(),r.second,r.first);
+
+	L.push_many(S);
+
+}
+
+/*
+ * distinct characters in L[l,r): the run-length encoded string enumerates
+ * them on the run heads
+ */
+template<>
+inline
+vector<pair<ulint,ulint> > rle_bwt::distinct_L(ulint l, ulint r) const {
+
+	return L.range_distinct(l,r);
+
+}
+
+/*
+ * distinct characters in L[l,r): only the wavelet tree nodes
+ * intersecting the range are visited
+ */
+template<>
+inline
+vector<pair<ulint,ulint> > wt_bwt::distinct_L(ulint l, ulint r) const {
+
+	return L.range_distinct(l,r);
+
+}
+
 template<>
 inline
 ulint rle_bwt::number_of_runs(){
@@ -254,6 +384,68 @@ ulint rle_bwt::number_of_runs(pair<ulint,ulint> interval) const {
 
 }
 
+template<>
+inline
+void rle_bwt::mark(ulint i, ulint x){
+
+	assert(i<bwt_length());
+	assert(i!=terminator_position);
+
+	L.mark(i < terminator_position ? i : i-1, x);
+
+}
+
+template<>
+inline
+bool rle_bwt::marked(ulint i) const {
+
+	assert(i<bwt_length());
+
+	return i!=terminator_position and L.marked(i < terminator_position ? i : i-1);
+
+}
+
+template<>
+inline
+ulint rle_bwt::mark_value(ulint i) const {
+
+	assert(marked(i));
+
+	return L.mark_value(i < terminator_position ? i : i-1);
+
+}
+
+template<>
+inline
+ulint rle_bwt::next_mark(ulint i) const {
+
+	assert(i<=bwt_length());
+
+	//the terminator is not marked: rows >= terminator_position are L[i-1]
+	ulint j = L.next_mark(i <= terminator_position ? i : i-1);
+
+	return j < terminator_position ? j : j+1;
+
+}
+
+/*
+ * remove L[i] and insert c in position j (after the removal). The
+ * mark of position i moves with it
+ */
+template<>
+inline
+void rle_bwt::move_L(ulint i, ulint j, char_type c){
+
+	bool m = L.marked(i);
+	ulint x = m ? L.mark_value(i) : 0;
+
+	L.remove(i);
+	L.insert(j,c);
+
+	if(m) L.mark(j,x);
+
+}
+
 /*
  * given a position i inside the string, return the interval [l,r) of the run containing i,
  * i.e. i \in [l,r) (right position always exclusive)
@@ -14,13 +14,17 @@
  *
  *  - fixed-size: number of bits of each char is fixed. Dynamic (but alphabet size is limited)
  *  - gamma encoding: alphabet is completely unknown at construction time. Dynamic (alphabet size < 2^64)
- *  - Huffman encoding: character probabilities are known at construction time. Static.
+ *  - Huffman encoding: character probabilities are known at construction time. Static, unless
+ *    an escape code is requested: characters not known at construction time are then encoded
+ *    as the escape code followed by a gamma code.
  *
  */
 
 #ifndef INCLUDE_INTERNAL_ALPHABET_ENCODER_HPP_
 #define INCLUDE_INTERNAL_ALPHABET_ENCODER_HPP_
 
+#include <tuple>
+
 #include "dynamic/internal/includes.hpp"
 
 namespace dyn {
@@ -32,6 +36,9 @@ public:
 	//we allow any alphabet
 	typedef uint64_t char_type;
 
+	//maximum length of Huffman codes: they always fit in a word
+	static const uint8_t MAX_CODE_LEN = 64;
+
 	/*
 	 * Constructor #1
 	 *
@@ -67,48 +74,36 @@ public:
 	 *
 	 * We know character probabilities. Input: pairs <character, probability>
 	 *
-	 * Here the alphabet is Huffman encoded.
+	 * Here the alphabet is Huffman encoded. Codes are optimal among those
+	 * of length at most max_len (package-merge algorithm) and canonical:
+	 * codes of the same length are consecutive integers, so decode uses a
+	 * table of O(max_len) words instead of a dictionary.
 	 *
 	 * Note: all characters that will appear in the text must be included
 	 * in P. If in doubt, assign probability 0 (such characters will get
-	 * the longest codes)
+	 * the longest codes). If escape is true, an escape leaf with probability
+	 * 0 is added to the tree and characters not in P can be encoded later.
 	 *
 	 */
-	alphabet_encoder(vector<pair<char_type,double> >& P){
-
-		sigma = P.size();
-		enc_type = huffman;
-
-		auto comp = [](node x, node y){ return x.second < y.second; };
-		multiset<node,decltype(comp)> s(comp);
-
-		//insert leaves
-		for(auto it = P.begin();it!=P.end();++it)
-			s.insert({{NULL,&it->first},it->second});
+	alphabet_encoder(vector<pair<char_type,double> >& P, bool escape = false, uint8_t max_len = MAX_CODE_LEN){
 
-		//Huffman algorithm
-		while(s.size()>1){
+		assert(P.size()>0);
+		assert(max_len>0 and max_len<=MAX_CODE_LEN);
 
-			//extract, copy and erase the 2 smallest elements
-			auto min1 = new node(*s.begin());
-
-			s.erase(s.begin());
-
-			auto min2 = new node(*s.begin());
-
-			s.erase(s.begin());
-
-			double new_prob = min1->second + min2->second;
-			pair<void*,void*> children = {min1,min2};
+		sigma = P.size();
+		enc_type = escape ? huffman_escape : huffman;
 
-			s.insert({ children, new_prob });
+		//the escape leaf is the last one
+		vector<double> w;
+		for(auto p : P) w.push_back(p.second);
+		if(escape) w.push_back(0);
 
-		}
+		auto len = code_lengths(w,max_len);
 
-		node root = *s.begin();
-		extract_codes(&root,{});
+		vector<pair<char_type,uint8_t> > C;
+		for(ulint i=0;i<P.size();++i) C.push_back({P[i].first,len[i]});
 
-		root.free_memory();
+		build_canonical(C, escape ? len.back() : 0);
 
 	}
 
@@ -141,6 +136,13 @@ public:
 
 				encode_[c] = get_new_fixed();
 
+			}else if(enc_type==huffman_escape){
+
+				vector<bool> C = escape_;
+				for(auto b : get_new_gamma()) C.push_back(b);
+
+				encode_[c] = C;
+
 			}
 
 			//0 is reserved
@@ -158,6 +160,9 @@ public:
 
 	char_type decode(const vector<bool>& code) const {
 
+		char_type c;
+		if(table_decode(code,c)) return c;
+
 		//code must be present in dictionary!
 		assert(decode_.at(code)!=0);
 
@@ -165,9 +170,27 @@ public:
 
 	}
 
+	/*
+	 * decode the canonical Huffman code of length len stored in the len
+	 * least significant bits of code (Huffman encoding only)
+	 */
+	char_type decode(uint64_t code, uint8_t len) const {
+
+		assert(len < first_code_.size());
+		assert(code >= first_code_[len]);
+		assert(code - first_code_[len] < first_index_[len+1] - first_index_[len]);
+
+		return symbols_[first_index_[len] + (code - first_code_[len])];
+
+	}
+
 	bool code_exists(const vector<bool>& code) const {
 
-		return decode_.at(code)!=0;
+		char_type c;
+		if(table_decode(code,c)) return true;
+
+		auto it = decode_.find(code);
+		return it != decode_.end() and it->second!=0;
 
 	}
 
@@ -218,6 +241,9 @@ public:
 
 		}
 
+		size += symbols_.capacity()*sizeof(char_type)*8;
+		size += (first_code_.capacity() + first_index_.capacity())*sizeof(uint64_t)*8;
+
 		return sizeof(alphabet_encoder)*8 + size;
 
 	}
@@ -264,6 +290,9 @@ public:
 		out.write((char*)&enc_type,sizeof(enc_type));
 		w_bytes += sizeof(enc_type);
 
+		if(enc_type==huffman_escape)
+			w_bytes += serialize_vec_bool(out, escape_);
+
 		return w_bytes;
 
 	}
@@ -306,6 +335,21 @@ public:
 
 		in.read((char*)&enc_type,sizeof(enc_type));
 
+		if(enc_type==huffman_escape)
+			load_vec_bool(in,escape_);
+
+		//rebuild the canonical decoding table
+		if(enc_type==huffman or enc_type==huffman_escape) build_table();
+
+	}
+
+	/*
+	 * true iif the encoding is static Huffman (new characters cannot be encoded)
+	 */
+	bool is_static() const {
+
+		return enc_type==huffman;
+
 	}
 
 private:
@@ -323,6 +367,7 @@ private:
 		for(auto b : vb){
 
 			w[i/64] = (w[i/64]<<1) + b;
+			++i;
 
 		}
 
@@ -362,90 +407,208 @@ private:
 
 	}
 
-	//recursive tree definition
-	//left/right children are stored in the 2 void pointers
-	//if the left void pointer is == NULL, then right pointer
-	//is a char_type (i.e. leaf)
-	class node{
+	/*
+	 * code lengths of an optimal prefix code for weights w with maximum
+	 * code length max_len, computed with the package-merge algorithm
+	 * in O(m * max_len) time and space, m = w.size().
+	 */
+	static vector<uint8_t> code_lengths(const vector<double>& w, uint8_t max_len){
+
+		const ulint m = w.size();
+		vector<uint8_t> len(m,0);
 
-	public:
+		if(m==1){
 
-		void free_memory(){
+			len[0] = 1;
+			return len;
 
-			if(first.first == NULL){
+		}
 
-				//leaf: first.second is a pointer to char_type
+		//no optimal code is longer than m-1 bits
+		if(max_len > m-1) max_len = m-1;
 
-				assert(first.second != NULL);
+		assert(max_len >= 64 or (uint64_t(1)<<max_len) >= m);
 
-			}else{
+		vector<ulint> order(m);
+		for(ulint i=0;i<m;++i) order[i] = i;
+		std::stable_sort(order.begin(),order.end(),[&](ulint a, ulint b){ return w[a] < w[b]; });
+
+		//items 0..m-1 are the leaves (in weight order), then packages.
+		//Package k has children child[k-m]
+		vector<double> weight(m);
+		vector<pair<ulint,ulint> > child;
+		for(ulint i=0;i<m;++i) weight[i] = w[order[i]];
+
+		vector<ulint> list(m);
+		for(ulint i=0;i<m;++i) list[i] = i;
+
+		for(uint8_t l=1;l<max_len;++l){
 
-				//not leaf: first.first and first.second are pointers to nodes
-				assert(first.second != NULL);
-				((node*)first.first)->free_memory();
-				((node*)first.second)->free_memory();
+			//package adjacent items of the previous list
+			vector<ulint> packages;
+			for(ulint k=0;k+1<list.size();k+=2){
 
-				delete (node*)first.first;
-				delete (node*)first.second;
+				packages.push_back(weight.size());
+				weight.push_back(weight[list[k]] + weight[list[k+1]]);
+				child.push_back({list[k],list[k+1]});
 
 			}
 
-		}
+			//merge with the leaves
+			vector<ulint> merged;
+			ulint i=0, j=0;
+			while(i<m or j<packages.size()){
+
+				if(j==packages.size() or (i<m and weight[i] <= weight[packages[j]]))
+					merged.push_back(i++);
+				else
+					merged.push_back(packages[j++]);
+
+			}
 
-		pair<void*,void*> first;
-		double second;
+			list = std::move(merged);
 
-	};
+		}
 
-	void extract_codes(node* n, const vector<bool>& C){
+		//each leaf in the subtrees of the first 2m-2 items gains one bit
+		vector<ulint> stack(list.begin(),list.begin()+2*m-2);
 
-		if(is_leaf(n)){
+		while(not stack.empty()){
 
-			assert(C.size()>0);
+			ulint x = stack.back();
+			stack.pop_back();
 
-			encode_[label(n)] = C;
-			decode_[C] = label(n)+1;
+			if(x<m){
 
-		}else{
+				len[order[x]]++;
 
-			vector<bool> l = C;
-			vector<bool> r = C;
+			}else{
 
-			l.push_back(false);
-			r.push_back(true);
+				stack.push_back(child[x-m].first);
+				stack.push_back(child[x-m].second);
 
-			extract_codes(left(n),l);
-			extract_codes(right(n),r);
+			}
 
 		}
 
+		return len;
+
 	}
 
-	bool is_leaf(node* n){
+	/*
+	 * assign canonical codes given <character, code length> pairs. If
+	 * escape_len > 0, an escape code of that length is also assigned.
+	 */
+	void build_canonical(const vector<pair<char_type,uint8_t> >& C, uint8_t escape_len){
 
-		return n->first.first==NULL;
+		//<length, index in C>. The escape (index C.size()) is the last of its length
+		vector<pair<uint8_t,ulint> > by_len;
+		for(ulint i=0;i<C.size();++i) by_len.push_back({C[i].second,i});
+		if(escape_len>0) by_len.push_back({escape_len,C.size()});
 
-	}
+		std::sort(by_len.begin(),by_len.end());
+
+		uint64_t code = 0;
+
+		for(ulint k=0;k<by_len.size();++k){
+
+			uint8_t l = by_len[k].first;
+			assert(l>0 and l<=MAX_CODE_LEN);
+
+			if(k>0) code = (code+1) << (l-by_len[k-1].first);
+
+			vector<bool> B(l);
+			for(uint8_t j=0;j<l;++j) B[j] = (code >> (l-j-1)) & uint64_t(1);
+
+			if(by_len[k].second == C.size()){
 
-	node* left(node* n){
+				escape_ = B;
 
-		assert(not is_leaf(n));
-		return (node*)n->first.first;
+			}else{
+
+				encode_[C[by_len[k].second].first] = B;
+
+			}
+
+		}
+
+		build_table();
 
 	}
 
-	node* right(node* n){
+	/*
+	 * build the canonical decoding table from the codes of the characters
+	 * known at construction time (and from the escape code)
+	 */
+	void build_table(){
+
+		//<length, code, character>
+		vector<tuple<uint8_t,uint64_t,char_type> > T;
+
+		auto value = [](const vector<bool>& B){
+
+			uint64_t x = 0;
+			for(auto b : B) x = (x<<1) | b;
+			return x;
 
-		assert(not is_leaf(n));
-		return (node*)n->first.second;
+		};
+
+		for(const auto& e : encode_){
+
+			//characters added after construction have the escape code as prefix
+			bool escaped = 	enc_type==huffman_escape and
+							e.second.size() > escape_.size() and
+							std::equal(escape_.begin(),escape_.end(),e.second.begin());
+
+			if(not escaped) T.push_back(make_tuple(e.second.size(),value(e.second),e.first));
+
+		}
+
+		if(enc_type==huffman_escape) T.push_back(make_tuple(escape_.size(),value(escape_),~char_type(0)));
+
+		std::sort(T.begin(),T.end());
+
+		uint8_t max_len = std::get<0>(T.back());
+
+		symbols_.clear();
+		first_code_ = vector<uint64_t>(max_len+1,0);
+		first_index_ = vector<uint64_t>(max_len+2,0);
+
+		for(ulint k=0;k<T.size();++k){
+
+			uint8_t l = std::get<0>(T[k]);
+
+			if(k==0 or l != std::get<0>(T[k-1])) first_code_[l] = std::get<1>(T[k]);
+
+			first_index_[l+1]++;
+			symbols_.push_back(std::get<2>(T[k]));
+
+		}
+
+		for(uint8_t l=1;l<=max_len+1;++l) first_index_[l] += first_index_[l-1];
 
 	}
 
-	char_type label(node *n){
+	/*
+	 * if code is one of the canonical Huffman codes assigned at construction
+	 * time, store its character in c and return true
+	 */
+	bool table_decode(const vector<bool>& code, char_type& c) const {
+
+		if(enc_type!=huffman and enc_type!=huffman_escape) return false;
+
+		ulint l = code.size();
+		if(l==0 or l>=first_code_.size()) return false;
 
-		assert(is_leaf(n));
+		uint64_t x = 0;
+		for(auto b : code) x = (x<<1) | b;
 
-		return *((char_type*)n->first.second);
+		if(x < first_code_[l] or x - first_code_[l] >= first_index_[l+1] - first_index_[l]) return false;
+
+		c = symbols_[first_index_[l] + (x - first_code_[l])];
+
+		//the escape code is not a character
+		return not (enc_type==huffman_escape and code == escape_);
 
 	}
 
@@ -494,8 +657,17 @@ private:
 
 	}
 
-	enum type {huffman, gamma, fixed};
+	enum type {huffman, gamma, fixed, huffman_escape};
+
+	//canonical Huffman decoding table (Huffman encoding only). Codes of
+	//length l are first_code_[l], first_code_[l]+1, ... and are associated
+	//to characters symbols_[first_index_[l]], ..., symbols_[first_index_[l+1]-1]
+	vector<char_type> symbols_;
+	vector<uint64_t> first_code_;
+	vector<uint64_t> first_index_;
 
+	//prefix of the codes of characters added after construction (huffman_escape only)
+	vector<bool> escape_;
 
 
     tsl::hopscotch_map<char_type,vector<bool> > encode_;
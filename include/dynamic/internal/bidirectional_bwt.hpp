@@ -0,0 +1,331 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * bidirectional_bwt.hpp
+ *
+ *  Dynamic bidirectional BWT of a collection of documents: the BWT of the
+ *  documents and the BWT of the reversed documents are kept in sync.
+ *  A pattern P is represented by a pair of intervals: the interval of P on
+ *  the forward BWT and the interval of reverse(P) on the reverse BWT. Both
+ *  have the same length, and P can be extended on both sides (extend_left,
+ *  extend_right) in O(log n) time per distinct character in the interval.
+ *
+ *  Since a BWT can only be left-extended, the structure grows by whole
+ *  documents (left-extending the forward text means appending to the
+ *  reversed text). Documents are delimited by an implicit separator
+ *  (character 2^64-2, reserved), also placed before the first and after the
+ *  last document: occurrences never span two documents, and the forward
+ *  and reverse texts do not need to be the reverse of each other.
+ *
+ *  Note: alphabet characters 2^64-1 and 2^64-2 are reserved
+ *
+ */
+
+#ifndef INCLUDE_INTERNAL_BIDIRECTIONAL_BWT_HPP_
+#define INCLUDE_INTERNAL_BIDIRECTIONAL_BWT_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn{
+
+template <class dyn_bwt>
+class bidirectional_bwt{
+
+public:
+
+	//we allow any alphabet
+	using char_type = ulint;
+
+	/*
+	 * interval of P on the forward BWT, interval of reverse(P) on the
+	 * reverse BWT. Intervals are [left,right) : right bound is excluded
+	 */
+	typedef pair<pair<ulint,ulint>, pair<ulint,ulint> > bi_interval;
+
+	/*
+	 * Constructor #1
+	 *
+	 * Alphabet is unknown. Characters are gamma-coded.
+	 *
+	 */
+	bidirectional_bwt(){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #2
+	 *
+	 * We know only alphabet size (the separator is added to the alphabet).
+	 * Each character is assigned log2(sigma+1) bits.
+	 *
+	 */
+	bidirectional_bwt(uint64_t sigma) : fwd(sigma+1), rev(sigma+1){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #3
+	 *
+	 * We know character probabilities. Input: pairs <character, probability>
+	 * The separator is added with the smallest probability in P.
+	 *
+	 * Here the alphabet is Huffman encoded.
+	 *
+	 */
+	bidirectional_bwt(vector<pair<char_type,double> >& P) : bidirectional_bwt(with_separator(P), true){}
+
+	/*
+	 * add document D (in reading order) to the collection
+	 */
+	void add_document(const vector<char_type>& D){
+
+		//forward text: D is prepended, right to left
+		for(ulint i=D.size();i>0;--i){
+
+			assert(D[i-1] != SEPARATOR);
+			fwd.extend(D[i-1]);
+
+		}
+
+		//reverse text: reverse(D) is prepended, i.e. D left to right
+		for(auto c : D) rev.extend(c);
+
+		fwd.extend(SEPARATOR);
+		rev.extend(SEPARATOR);
+
+		n_docs++;
+
+	}
+
+	/*
+	 * interval pair of the empty pattern
+	 */
+	bi_interval full_interval() const {
+
+		return {{0,fwd.size()},{0,rev.size()}};
+
+	}
+
+	/*
+	 * Input: interval pair of P, and a character c
+	 * Output: interval pair of cP (empty if cP does not occur)
+	 */
+	bi_interval extend_left(bi_interval I, char_type c) const {
+
+		return extend(fwd, I.first, I.second, c, false);
+
+	}
+
+	/*
+	 * Input: interval pair of P, and a character c
+	 * Output: interval pair of Pc (empty if Pc does not occur)
+	 */
+	bi_interval extend_right(bi_interval I, char_type c) const {
+
+		return extend(rev, I.second, I.first, c, true);
+
+	}
+
+	/*
+	 * Input: interval pair of P
+	 * Output: the distinct characters c such that cP occurs, with the
+	 * number of occurrences of cP (sorted by character). Occurrences of P
+	 * at the beginning of a document are not reported.
+	 */
+	vector<pair<char_type,ulint> > left_symbols(bi_interval I) const {
+
+		return symbols(fwd, I.first);
+
+	}
+
+	/*
+	 * Input: interval pair of P
+	 * Output: the distinct characters c such that Pc occurs, with the
+	 * number of occurrences of Pc (sorted by character). Occurrences of P
+	 * at the end of a document are not reported.
+	 */
+	vector<pair<char_type,ulint> > right_symbols(bi_interval I) const {
+
+		return symbols(rev, I.second);
+
+	}
+
+	/*
+	 * interval pair of pattern P (backward search on the forward BWT)
+	 */
+	bi_interval count(vector<char_type> P) const {
+
+		bi_interval I = full_interval();
+
+		for(ulint i=P.size();i>0 and size(I)>0;--i) I = extend_left(I, P[i-1]);
+
+		return I;
+
+	}
+
+	/*
+	 * number of occurrences of the pattern represented by I
+	 */
+	static ulint size(bi_interval I){
+
+		return I.first.second - I.first.first;
+
+	}
+
+	/*
+	 * the forward BWT (documents) and the reverse BWT (reversed documents)
+	 */
+	const dyn_bwt& forward() const { return fwd; }
+	const dyn_bwt& reverse() const { return rev; }
+
+	ulint number_of_documents() const {
+
+		return n_docs;
+
+	}
+
+	/*
+	 * total length of the documents (separators excluded)
+	 */
+	ulint text_length() const {
+
+		return fwd.text_length() - n_docs - 1;
+
+	}
+
+	/*
+	 * Total number of bits allocated in RAM for this structure
+	 *
+	 * WARNING: this measure is good only for relatively small alphabets (e.g. ASCII)
+	 * as we use STL containers such as set and map which do not give direct info on
+	 * the total memory allocated. The sizes of these containers are proportional
+	 * to the alphabet size (but the constants involved are high since internally
+	 * they can use heavy structures as RBT)
+	 */
+	ulint bit_size() const {
+
+		return sizeof(bidirectional_bwt<dyn_bwt>)*8 + fwd.bit_size() + rev.bit_size();
+
+	}
+
+	ulint serialize(ostream &out) const {
+
+		ulint w_bytes=0;
+
+		w_bytes += fwd.serialize(out);
+		w_bytes += rev.serialize(out);
+
+		out.write((char*)&n_docs,sizeof(n_docs));
+		w_bytes += sizeof(n_docs);
+
+		return w_bytes;
+
+	}
+
+	void load(istream &in){
+
+		fwd.load(in);
+		rev.load(in);
+
+		in.read((char*)&n_docs,sizeof(n_docs));
+
+	}
+
+private:
+
+	/*
+	 * Huffman-encoded BWTs, P includes the separator
+	 */
+	bidirectional_bwt(vector<pair<char_type,double> > P, bool) : fwd(P), rev(P){
+
+		init();
+
+	}
+
+	/*
+	 * both texts start with a separator, so that the first document
+	 * is delimited on both sides
+	 */
+	void init(){
+
+		fwd.extend(SEPARATOR);
+		rev.extend(SEPARATOR);
+
+	}
+
+	static vector<pair<char_type,double> > with_separator(vector<pair<char_type,double> > P){
+
+		assert(P.size()>0);
+
+		double p = P[0].second;
+		for(auto x : P) p = std::min(p, x.second);
+
+		P.push_back({char_type(SEPARATOR),p});
+
+		return P;
+
+	}
+
+	/*
+	 * extend the pattern with c on the side of B, where I is the interval on
+	 * B and J the interval on the other BWT. The occurrences followed (in
+	 * the other BWT) by a character smaller than c precede the new interval
+	 * in J: these are the characters smaller than c in B's L[I] plus the
+	 * terminator, which is the smallest character. Separators are the
+	 * largest characters, hence they are never counted.
+	 */
+	bi_interval extend(const dyn_bwt& B, pair<ulint,ulint> I, pair<ulint,ulint> J, char_type c, bool swap) const {
+
+		assert(c != SEPARATOR);
+
+		auto I1 = B.LF(I, c);
+
+		if(I1.second <= I1.first) return {{0,0},{0,0}};
+
+		auto tp = B.get_terminator_position();
+		ulint smaller = I.first <= tp and tp < I.second ? 1 : 0;
+
+		for(auto s : B.interval_symbols(I)){
+
+			if(s.first >= c) break;
+			smaller += s.second;
+
+		}
+
+		pair<ulint,ulint> J1 = {J.first + smaller, J.first + smaller + (I1.second - I1.first)};
+
+		return swap ? bi_interval(J1,I1) : bi_interval(I1,J1);
+
+	}
+
+	vector<pair<char_type,ulint> > symbols(const dyn_bwt& B, pair<ulint,ulint> I) const {
+
+		auto S = B.interval_symbols(I);
+
+		//the separator is the largest character
+		if(not S.empty() and S.back().first == SEPARATOR) S.pop_back();
+
+		return S;
+
+	}
+
+	//implicit document separator
+	static const char_type SEPARATOR = ~ulint(0)-1;
+
+	//BWT of the documents and of the reversed documents
+	dyn_bwt fwd;
+	dyn_bwt rev;
+
+	ulint n_docs = 0;
+
+};
+
+}
+
+#endif /* INCLUDE_INTERNAL_BIDIRECTIONAL_BWT_HPP_ */
@@ -23,6 +23,8 @@
 
 #include "dynamic/internal/includes.hpp"
 
+#include "dynamic/internal/packed_vector.hpp"
+#include "dynamic/internal/spsi.hpp"
 #include "dynamic/internal/gap_bitvector.hpp"
 #include "dynamic/internal/rle_string.hpp"
 #include "dynamic/internal/wt_string.hpp"
@@ -116,6 +118,491 @@ public:
 	 */
 	void build_from_string(string& bwt, char terminator, bool verbose=false);
 
+	/*
+	 * build structure (must be empty) from the runs of the BWT, in order:
+	 * next_run() returns the next run <c,k>, k = 0 at the end. The
+	 * terminator is the single character equal to terminator.
+	 *
+	 * The BWT is never held uncompressed: runs are appended to L in
+	 * batches of at most RUN_BATCH characters with the bulk path (see
+	 * push_L). Used to load the output of cw_bwt (see cw_bwt::toBWT)
+	 */
+	template<class run_source>
+	void build_from_run_stream(run_source next_run, char_type terminator, bool verbose=false){
+
+		assert(F.size()==0 and L.size()==0);
+
+		const ulint step = 1000000;	//print status every step characters
+		ulint last_step = 0;
+
+		map<char_type,ulint> freq;
+
+		vector<pair<char_type,ulint> > batch;
+		ulint in_batch = 0;
+
+		ulint n = 0;
+		bool terminator_found = false;
+
+		for(auto r = next_run(); r.second > 0; r = next_run()){
+
+			if(r.first == terminator){
+
+				//there must be only one terminator in the BWT
+				assert(not terminator_found and r.second == 1);
+
+				terminator_found = true;
+				terminator_position = n++;
+
+				continue;
+
+			}
+
+			freq[r.first] += r.second;
+			n += r.second;
+
+			//long runs are split so that the batch is bounded
+			while(r.second > 0){
+
+				ulint k = std::min(r.second, RUN_BATCH - in_batch);
+
+				if(batch.size()>0 and batch.back().first == r.first) batch.back().second += k;
+				else batch.push_back({r.first,k});
+
+				in_batch += k;
+				r.second -= k;
+
+				if(in_batch == RUN_BATCH){
+
+					push_L(batch);
+					batch.clear();
+					in_batch = 0;
+
+				}
+
+			}
+
+			if(verbose and n > last_step+(step-1)){
+
+				last_step = n;
+				cout << " " << n << " characters processed ..." << endl;
+
+			}
+
+		}
+
+		push_L(batch);
+
+		assert(terminator_found);
+		(void)terminator_found;
+
+		for(auto f : freq){
+
+			F.insert(F.size(),f.first,f.second);
+			alphabet.insert(f.first);
+
+		}
+
+		assert(bwt_length() == n);
+
+	}
+
+	/*
+	 * build the BWT of text B·sep·A from the BWTs of A and B (this BWT must
+	 * be empty). The suffixes starting in A are those of A; the suffixes
+	 * starting in B·sep are inserted from the shortest, as in extend: their
+	 * rank among A's suffixes is computed with LF on A, their rank among the
+	 * suffixes of B·sep already inserted with LF on their (dynamic) BWT.
+	 * Comparisons never stop at B's end, so the result is the BWT of B·sep·A
+	 * for any sep (also a character of A or B). The merged L column is then
+	 * written run by run with the bulk path.
+	 *
+	 * Time: O(|B| log n) + the time to write the runs of A's and B's rows.
+	 *
+	 * returns the rows of the suffixes starting in B·sep (sorted). Their
+	 * text positions are the positions in B shifted by A.bwt_length(): the
+	 * separator takes position 0 of B (its terminator)
+	 */
+	vector<ulint> merge(const bwt& A, const bwt& B, char_type sep){
+
+		assert(bwt_length()==1);
+		assert(sep != TERMINATOR);
+
+		ulint tA = A.terminator_position;
+
+		/*
+		 * suffixes of B·sep·A starting in B·sep, in lexicographic order:
+		 * first characters (FB), characters preceding them (LB: all but the
+		 * last inserted suffix, whose row is p) and number of suffixes of A
+		 * smaller than them (rank_A)
+		 */
+		rle_string_type FB;
+		rle_string_type LB;
+		set<char_type> alph;
+		spsi<packed_vector,256,16> rank_A;
+
+		//the shortest: sep·A
+		ulint a = A.LF_any(tA, sep);
+
+		FB.insert(0,sep);
+		alph.insert(sep);
+		rank_A.insert(0,a);
+
+		ulint p = 0;
+
+		//B's text, from its end
+		for(ulint i = 0;B.at(i) != TERMINATOR;i = B.LF(i)){
+
+			char_type c = B.at(i);
+
+			//first row of c among the suffixes of B·sep
+			auto upit = alph.lower_bound(c);
+			ulint b = 	upit==alph.end() ? FB.size() : FB.select(0,*upit);
+
+			/*
+			 * suffixes cZ smaller than cY (Y = last inserted suffix): Z is
+			 * a suffix of B·sep smaller than Y preceded by c, or Z = A for
+			 * the suffix sep·A (if A < Y)
+			 */
+			b += LB.rank(p,c);
+			if(c == sep and a > tA) b++;
+
+			a = A.LF_any(a, c);
+
+			LB.insert(p,c);
+			FB.insert(b,c);
+			alph.insert(c);
+			rank_A.insert(b,a);
+
+			p = b;
+
+		}
+
+		/*
+		 * merged L column: rows of A interleaved with the rows of B·sep. The
+		 * terminator precedes B·sep·A
+		 */
+		merged_L out(A, sep);
+		vector<ulint> rows_B;
+
+		for(ulint j=0;j<rank_A.size();++j){
+
+			out.rows_of_A(rank_A.at(j));
+
+			rows_B.push_back(out.n);
+
+			if(j == p){
+
+				terminator_position = out.n++;
+
+			}else{
+
+				out.push(LB.at(j < p ? j : j-1));
+
+			}
+
+		}
+
+		out.rows_of_A(A.bwt_length());
+
+		build_from_runs(out.runs);
+
+		assert(bwt_length() == A.bwt_length() + B.bwt_length());
+
+		return rows_B;
+
+	}
+
+	/*
+	 * build the BWT of text B·A from the BWTs of A and B (this BWT must be
+	 * empty), i.e. the BWT obtained extending A with the characters used to
+	 * extend B, in the same order. Used to build the BWT of a long text by
+	 * chunks.
+	 *
+	 * The suffixes of B·A starting in B are sorted as the corresponding
+	 * suffixes of B$, except when a suffix Y of B is a prefix of another
+	 * suffix X = YW: then X < Y iff WA < A. Only the suffixes of B occurring
+	 * also elsewhere in B (the "short" ones: if a suffix occurs twice, so do
+	 * its suffixes) can be such Y. Hence:
+	 *
+	 * - the other ("long") suffixes keep their order in B's BWT;
+	 * - the short suffixes are sorted among themselves inserting them from
+	 *   the shortest in a small dynamic BWT, as in merge;
+	 * - the number of long suffixes smaller than a short suffix cY follows
+	 *   from the one of Y with a rank on B's L column restricted to the
+	 *   rows of the long suffixes;
+	 * - the ranks among A's suffixes are computed with LF on A. They do not
+	 *   decrease in the merged order of the suffixes of B, so they are just
+	 *   sorted.
+	 *
+	 * Only the short suffixes (typically a handful) are inserted in dynamic
+	 * structures: for the other characters of B the merge performs one LF on
+	 * A. The merged L column is written run by run with the bulk path.
+	 *
+	 * next(): the characters used to extend B, in the same order (i.e. B's
+	 * text from its end). Typically they are read again from the input.
+	 *
+	 * Time: O(|B| log n) + the time to write the runs of A's and B's rows.
+	 */
+	template<class next_char>
+	void concatenate(const bwt& A, const bwt& B, next_char next){
+
+		assert(bwt_length()==1);
+		assert(B.bwt_length() > 1);
+
+		ulint tA = A.terminator_position;
+		ulint m = B.bwt_length()-1;
+
+		//the last character of B: the row of A is preceded by it
+		char_type last = B.at(0);
+
+		//number of A's suffixes smaller than each suffix of B·A starting in B
+		vector<ulint> rank_A;
+		rank_A.reserve(m);
+
+		/*
+		 * short suffixes, from the shortest: their row in B, first character
+		 * and rank among A's suffixes
+		 */
+		struct short_suffix{
+
+			ulint row;
+			char_type c;
+			ulint a;
+
+		};
+
+		vector<short_suffix> S;
+
+		//long suffixes smaller than A
+		ulint small = 0;
+
+		//rows of B prefixed by the part in B of the current suffix (while short)
+		pair<ulint,ulint> I = {0,B.bwt_length()};
+
+		ulint a = tA;
+
+		for(ulint t=0;t<m;++t){
+
+			char_type c = next();
+
+			a = A.LF_any(a, c);
+			rank_A.push_back(a);
+
+			if(I.second - I.first > 1) I = B.LF(I, c);
+
+			//the suffix of B$ is the smallest of its interval
+			if(I.second - I.first > 1) S.push_back({I.first,c,a});
+			else if(a <= tA) small++;
+
+		}
+
+		std::sort(rank_A.begin(),rank_A.end());
+
+		ulint l = S.size();
+
+		/*
+		 * order of the short suffixes: rank_S[u] = number of short suffixes
+		 * smaller than S[u]. FB, LB and p as in merge, ids: indexes in S in
+		 * lexicographic order
+		 */
+		vector<ulint> rank_S(l);
+
+		{
+
+			rle_string_type FB;
+			rle_string_type LB;
+			set<char_type> alph;
+			spsi<packed_vector,256,16> ids;
+
+			ulint p = 0;
+
+			for(ulint u=0;u<l;++u){
+
+				char_type c = S[u].c;
+
+				auto upit = alph.lower_bound(c);
+				ulint b = 	upit==alph.end() ? FB.size() : FB.select(0,*upit);
+
+				if(u > 0){
+
+					b += LB.rank(p,c);
+					if(c == last and S[u-1].a > tA) b++;
+
+					LB.insert(p,c);
+
+				}
+
+				FB.insert(b,c);
+				alph.insert(c);
+				ids.insert(b,u);
+
+				p = b;
+
+			}
+
+			for(ulint j=0;j<l;++j) rank_S[ids.at(j)] = j;
+
+		}
+
+		/*
+		 * rows of B that are not of long suffixes: row 0 and the rows of the
+		 * short suffixes. NL_L: the same rows by the character preceding
+		 * them, NL_F: the first characters of the short suffixes
+		 */
+		vector<ulint> NL = {0};
+		map<char_type,vector<ulint> > NL_L;
+		vector<char_type> NL_F;
+
+		NL_L[last].push_back(0);
+
+		for(auto y : S){
+
+			NL.push_back(y.row);
+			NL_F.push_back(y.c);
+
+			char_type d = B.at(y.row);
+			if(d != TERMINATOR) NL_L[d].push_back(y.row);
+
+		}
+
+		std::sort(NL.begin(),NL.end());
+		std::sort(NL_F.begin(),NL_F.end());
+		for(auto& v : NL_L) std::sort(v.second.begin(),v.second.end());
+
+		//D[k] = NL[k]-k: the P-th long suffix is in row P+(number of D[k] <= P)
+		vector<ulint> D;
+		for(ulint k=0;k<NL.size();++k) D.push_back(NL[k]-k);
+
+		/*
+		 * number of long suffixes smaller than cY, given the number P of
+		 * long suffixes smaller than Y
+		 */
+		auto long_smaller = [&](char_type c, ulint P) -> ulint {
+
+			ulint R = P + (std::upper_bound(D.begin(),D.end(),P) - D.begin());
+
+			//long suffixes starting with a character smaller than c
+			ulint f = B.LF(0,c) - 1 - (std::lower_bound(NL_F.begin(),NL_F.end(),c) - NL_F.begin());
+
+			//long suffixes cZ with Z among the first P long suffixes
+			auto& v = NL_L[c];
+			ulint k = B.LF(R,c) - B.LF(0,c) - (std::lower_bound(v.begin(),v.end(),R) - v.begin());
+
+			return f + k;
+
+		};
+
+		/*
+		 * P[u] = number of long suffixes smaller than the short suffix S[u].
+		 * The only long suffix cZ with Z short is the one preceding the
+		 * longest short suffix S[l-1]: it is smaller than cY iff S[l-1] < Y
+		 */
+		vector<ulint> P(l);
+
+		char_type d = l > 0 ? B.at(S[l-1].row) : TERMINATOR;
+
+		for(ulint u=0;u<l;++u){
+
+			char_type c = S[u].c;
+
+			bool lower = u == 0 ? S[l-1].a <= tA : rank_S[l-1] < rank_S[u-1];
+
+			P[u] = long_smaller(c, u == 0 ? small : P[u-1]) + (c == d and lower);
+
+		}
+
+		vector<ulint> ids(l);
+		for(ulint u=0;u<l;++u) ids[rank_S[u]] = u;
+
+		/*
+		 * merged L column: rows of A interleaved with the rows of B, the long
+		 * suffixes in B's order and the short ones after P[u] long suffixes.
+		 * The terminator precedes B·A
+		 */
+		merged_L out(A, last);
+
+		ulint k = 0;	//rows of B written
+
+		auto write = [&](char_type c){
+
+			out.rows_of_A(rank_A[k++]);
+
+			if(c == TERMINATOR) terminator_position = out.n++;
+			else out.push(c);
+
+		};
+
+		//run of B's L containing the current row: [rs,re) on L, character rc
+		ulint tB = B.terminator_position;
+		ulint rs = 0, re = 0;
+		char_type rc = TERMINATOR;
+
+		auto B_at = [&](ulint i) -> char_type {
+
+			if(i == tB) return TERMINATOR;
+
+			ulint j = i < tB ? i : i-1;
+
+			if(j < rs or j >= re){
+
+				auto r = B.run_of_L(j);
+				rs = r.first;
+				re = r.second;
+				rc = B.L.at(j);
+
+			}
+
+			return rc;
+
+		};
+
+		ulint j = 0;	//next short suffix
+		ulint h = 1;	//next row of NL
+		ulint q = 0;	//long suffixes written
+
+		for(ulint i=1;i<=m;++i){
+
+			if(h < NL.size() and NL[h] == i){
+
+				h++;
+				continue;
+
+			}
+
+			for(;j<l and P[ids[j]] <= q;++j) write(B.at(S[ids[j]].row));
+
+			write(B_at(i));
+			q++;
+
+		}
+
+		for(;j<l;++j) write(B.at(S[ids[j]].row));
+
+		out.rows_of_A(A.bwt_length());
+
+		build_from_runs(out.runs);
+
+		assert(bwt_length() == A.bwt_length() + m);
+
+	}
+
+	/*
+	 * concatenate(A,B,next) reading B's text from B itself (with LF)
+	 */
+	void concatenate(const bwt& A, const bwt& B){
+
+		ulint i = 0;
+
+		concatenate(A, B, [&]() -> char_type {
+
+			char_type c = B.at(i);
+			i = B.LF(i);
+			return c;
+
+		});
+
+	}
+
 	/*
 	 * build BWT(cW) from BWT(W)
 	 */
@@ -156,6 +643,89 @@ public:
 
 	}
 
+	/*
+	 * build BWT of W from BWT of Wa, i.e. remove the last character of the
+	 * text: the first character given to extend among those still in the
+	 * text. The suffix a·TERMINATOR disappears and every other suffix
+	 * loses its last character, which can change the order of the rows:
+	 * the rows are reordered as in Salson et al., "A four-stage algorithm
+	 * for updating a Burrows-Wheeler transform" (TCS 2009), starting from
+	 * the shortest suffix and stopping at the first suffix already in
+	 * place. Time: O((1+m) log n), m being the number of moved rows.
+	 *
+	 * on_remove(i) is called before row i is removed, on_move(i,j) before
+	 * row i is moved to row j (row i is removed and inserted again in
+	 * position j: the rows in between shift by one), so that data
+	 * associated with the rows can follow them.
+	 */
+	template<class on_remove_t, class on_move_t>
+	void shrink(on_remove_t on_remove, on_move_t on_move){
+
+		assert(text_length()>0);
+
+		//last character of the text and row of the suffix a·TERMINATOR
+		char_type a = at(0);
+		ulint p = LF(0);
+
+		//character before a
+		char_type b = at(p);
+
+		//row of the suffix b·a·TERMINATOR
+		ulint j = b == TERMINATOR ? 0 : LF(p);
+
+		//remove row p
+		on_remove(p);
+
+		if(p == terminator_position){
+
+			//the text was just a: only the terminator is left
+			L.remove(0);
+			terminator_position = 0;
+
+		}else{
+
+			L.remove(p < terminator_position ? p : p-1);
+			if(p < terminator_position) terminator_position--;
+
+		}
+
+		F.remove(p-1);
+		if(F.size() == 0 or F.rank(F.size(),a) == 0) alphabet.erase(a);
+
+		if(b == TERMINATOR) return;
+
+		if(j > p) j--;
+
+		//the suffix TERMINATOR is now preceded by b
+		move_L(0,0,b);
+
+		//expected row of the suffix in row j
+		ulint e = LF(0);
+
+		while(j != e){
+
+			//row of the next (longer) suffix (LF is computed before the move)
+			ulint next = LF(j);
+
+			on_move(j, e);
+			move_row(j, e);
+
+			j = next;
+			e = LF(e);
+
+		}
+
+	}
+
+	/*
+	 * remove the last character of the text (see above)
+	 */
+	void shrink(){
+
+		shrink([](ulint){}, [](ulint, ulint){});
+
+	}
+
 	/*
 	 * Input: interval of a string W, and a character c
 	 * Output: interval of cW
@@ -213,6 +783,34 @@ public:
 
 	}
 
+	/*
+	 * Input: interval [left,right) of the BWT
+	 * Output: the distinct characters in L[left,right) with their number of
+	 * occurrences in L[left,right), sorted by character. The terminator is
+	 * not reported.
+	 */
+	vector<pair<char_type,ulint> > interval_symbols(pair<ulint,ulint> interval) const {
+
+		assert(interval.first <= bwt_length() and interval.second <= bwt_length());
+
+		if(interval.first >= interval.second) return {};
+
+		//TERMINATOR is not explicitly stored in L
+		ulint l = 	interval.first <= terminator_position ?
+					interval.first :
+					interval.first-1;
+
+		ulint r = 	interval.second <= terminator_position ?
+					interval.second :
+					interval.second-1;
+
+		auto res = distinct_L(l,r);
+		std::sort(res.begin(),res.end());
+
+		return res;
+
+	}
+
 	/*
 	 * LF function
 	 */
@@ -244,6 +842,18 @@ public:
 
 	}
 
+	/*
+	 * character in position i of the F column (first character of the
+	 * i-th suffix in lexicographic order)
+	 */
+	char_type F_at(ulint i) const {
+
+		assert(i<bwt_length());
+
+		return i==0 ? TERMINATOR : F[i-1];
+
+	}
+
 	/*
 	 * FL function
 	 */
@@ -265,6 +875,50 @@ public:
 
 	}
 
+	/*
+	 * FL function on a batch of positions, sorted in increasing order.
+	 * Positions falling in the same run of F (i.e. with the same
+	 * F character) share the access and rank on F.
+	 */
+	vector<ulint> FL(const vector<ulint>& rows) const {
+
+		vector<ulint> res(rows.size());
+
+		ulint k = 0;
+
+		while(k < rows.size()){
+
+			assert(k==0 or rows[k-1] <= rows[k]);
+			assert(rows[k]<bwt_length());
+
+			if(rows[k]==0){
+
+				res[k++] = terminator_position;
+				continue;
+
+			}
+
+			//run of F containing the row, and number of its characters before the run
+			auto run = F.locate_run(rows[k]-1);
+			char_type c = F[rows[k]-1];
+			ulint before = F.rank(run.first,c);
+
+			//ranks of the rows' characters in L
+			vector<ulint> I;
+			for(ulint h=k;h < rows.size() and rows[h]-1 < run.second;++h) I.push_back(before + rows[h]-1-run.first);
+
+			for(auto j : select_L(I,c)){
+
+				res[k++] = j >= terminator_position ? j+1 : j;
+
+			}
+
+		}
+
+		return res;
+
+	}
+
 	pair<ulint, ulint> get_full_interval() const {
 
 		return {0,bwt_length()};
@@ -349,6 +1003,37 @@ public:
 	 */
 	pair<ulint,ulint> locate_run(ulint i) const;
 
+	/*
+	 * mark BWT position i (not the terminator) with value x. Marks move
+	 * with the insertions, without updates per inserted character, and
+	 * with the rows reordered by shrink (see rle_string::mark). Marks
+	 * split the runs of the BWT.
+	 *
+	 * defined only for rle_bwt (see dynamic.hpp)
+	 */
+	void mark(ulint i, ulint x);
+
+	/*
+	 * is BWT position i marked?
+	 *
+	 * defined only for rle_bwt (see dynamic.hpp)
+	 */
+	bool marked(ulint i) const;
+
+	/*
+	 * value of the marked BWT position i
+	 *
+	 * defined only for rle_bwt (see dynamic.hpp)
+	 */
+	ulint mark_value(ulint i) const;
+
+	/*
+	 * first marked BWT position >= i (bwt_length() if there is none)
+	 *
+	 * defined only for rle_bwt (see dynamic.hpp)
+	 */
+	ulint next_mark(ulint i) const;
+
 	/*
 	 * return alphabet, INCLUDED BWT terminator
 	 */
@@ -429,6 +1114,196 @@ public:
 
 private:
 
+	/*
+	 * select on L of all ranks in I (sorted). Specialized for
+	 * rle_bwt (see dynamic.hpp) to share work among ranks in the same run
+	 */
+	/*
+	 * distinct characters in L[l,r) with their frequencies (any order).
+	 * Generic version: one rank pair per alphabet character
+	 */
+	vector<pair<char_type,ulint> > distinct_L(ulint l, ulint r) const {
+
+		vector<pair<char_type,ulint> > res;
+
+		for(auto c : alphabet){
+
+			ulint k = L.rank(r,c) - L.rank(l,c);
+			if(k>0) res.push_back({c,k});
+
+		}
+
+		return res;
+
+	}
+
+	/*
+	 * writes the L column of a merged BWT run by run: rows of A (the row of
+	 * A itself is preceded by sep) interleaved with the rows of the suffixes
+	 * starting in the other text
+	 */
+	struct merged_L{
+
+		merged_L(const bwt& A, char_type sep) : A(A), sep(sep){}
+
+		void push(char_type c, ulint k = 1){
+
+			if(runs.size()>0 and runs.back().first == c) runs.back().second += k;
+			else runs.push_back({c,k});
+
+			n += k;
+
+		}
+
+		/*
+		 * write A's rows up to row r (excluded)
+		 */
+		void rows_of_A(ulint r){
+
+			ulint tA = A.terminator_position;
+
+			while(x < r){
+
+				if(x == tA){
+
+					push(sep);
+					x++;
+					continue;
+
+				}
+
+				//run of A's L containing row x, cut at the terminator and at r
+				ulint j = x < tA ? x : x-1;
+				ulint e = A.run_of_L(j).second;
+				e = x < tA ? std::min(e,tA) : e+1;
+				e = std::min(e,r);
+
+				push(A.L.at(j),e-x);
+				x = e;
+
+			}
+
+		}
+
+		const bwt& A;
+		char_type sep;
+
+		vector<pair<char_type,ulint> > runs;
+
+		ulint x = 0;	//next row of A
+		ulint n = 0;	//merged rows written
+
+	};
+
+	/*
+	 * run of L containing position i (on L, i.e. terminator excluded).
+	 * Generic version: single characters. Specialized for rle_bwt
+	 * (see dynamic.hpp)
+	 */
+	pair<ulint,ulint> run_of_L(ulint i) const {
+
+		return {i,i+1};
+
+	}
+
+	/*
+	 * append characters to L. Generic version: one character at a time.
+	 * Specialized for rle_bwt and wt_bwt (see dynamic.hpp)
+	 */
+	void push_L(const vector<pair<char_type,ulint> >& runs){
+
+		for(auto r : runs)
+			for(ulint k=0;k<r.second;++k) L.push_back(r.first);
+
+	}
+
+	/*
+	 * fill the empty F and L from the runs of L (terminator excluded;
+	 * terminator_position must be already set)
+	 */
+	void build_from_runs(const vector<pair<char_type,ulint> >& runs){
+
+		assert(F.size()==0 and L.size()==0);
+
+		map<char_type,ulint> freq;
+		for(auto r : runs) freq[r.first] += r.second;
+
+		for(auto f : freq){
+
+			F.insert(F.size(),f.first,f.second);
+			alphabet.insert(f.first);
+
+		}
+
+		push_L(runs);
+
+	}
+
+	/*
+	 * LF(i,c) for any character c, also if c does not occur in the text:
+	 * number of suffixes smaller than c followed by the suffix in row i
+	 */
+	ulint LF_any(ulint i, char_type c) const {
+
+		assert(i<=bwt_length());
+
+		ulint j = i <= terminator_position ? i : i-1;
+
+		//first row of c: add 1 for the terminator
+		auto upit = alphabet.lower_bound(c);
+		ulint f = 	upit==alphabet.end() ? F.size() : F.select(0,*upit);
+
+		return 	f + 1 + (alphabet.find(c)==alphabet.end() ? 0 : L.rank(j,c));
+
+	}
+
+	vector<ulint> select_L(const vector<ulint>& I, char_type c) const {
+
+		vector<ulint> res;
+		for(auto i : I) res.push_back(L.select(i,c));
+
+		return res;
+
+	}
+
+	/*
+	 * move row i to row j: the row is removed and inserted again in
+	 * position j. The moved row and row j begin with the same character,
+	 * hence F does not change
+	 */
+	void move_row(ulint i, ulint j){
+
+		if(i == j) return;
+
+		if(i == terminator_position){
+
+			terminator_position = j;
+			return;
+
+		}
+
+		char_type c = at(i);
+
+		ulint t = i < terminator_position ? terminator_position-1 : terminator_position;
+
+		move_L(i < terminator_position ? i : i-1, j <= t ? j : j-1, c);
+
+		terminator_position = j <= t ? t+1 : t;
+
+	}
+
+	/*
+	 * remove L[i] and insert c in position j (after the removal)
+	 *
+	 * specialized for rle_bwt, where marks follow the characters (see dynamic.hpp)
+	 */
+	void move_L(ulint i, ulint j, char_type c){
+
+		L.remove(i);
+		L.insert(j,c);
+
+	}
+
 	void insert_in_F(char_type c, ulint k=1){
 
 		//position in F where c has to be inserted
@@ -468,6 +1343,9 @@ private:
 	//TERMINATOR character: we reserve the integer 2^64-1
 	static const char_type TERMINATOR = ~ulint(0);
 
+	//characters appended to L at once by build_from_run_stream
+	static const ulint RUN_BATCH = ulint(1)<<20;
+
 	//stores the alphabet. Useful to infer lexicographic order
 	//of new incoming characters in log sigma time. TERMINATOR is not
 	//here.
@@ -0,0 +1,166 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * BackwardMMapIterator.h
+ *
+ *      Description: scans a file backwards through a read-only memory mapping (POSIX only).
+ *      The kernel read-ahead works forward, hence it is disabled (MADV_RANDOM) and the file is
+ *      instead prefetched in blocks of PREFETCH_BLOCK bytes with MADV_WILLNEED, one block ahead of
+ *      the (backward) cursor. Blocks already read are released with MADV_DONTNEED, so that the
+ *      resident memory is ~2 blocks: each backward pass over the file is a scan of the page cache.
+ *
+ *      BWTIL_HAS_MMAP is defined if this iterator is available (see cw_bwt.hpp).
+ *
+ */
+
+#ifndef BACKWARDMMAPITERATOR_H_
+#define BACKWARDMMAPITERATOR_H_
+
+#include "dynamic/internal/includes.hpp"
+#include "dynamic/internal/cw_bwt/BackwardIterator.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#define BWTIL_HAS_MMAP
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace bwtil {
+
+class BackwardMMapIterator : public BackwardIterator{
+
+public:
+
+	BackwardMMapIterator(string &path){
+
+		this->path=path;
+
+		fd = open(path.c_str(), O_RDONLY);
+
+		if (fd == -1){
+		  cout << "Error while opening file " << path <<endl;
+		  exit(0);
+		}
+
+		struct stat st;
+
+		if(fstat(fd, &st) == -1){
+		  cout << "Error while reading file " << path <<endl;
+		  exit(0);
+		}
+
+		n = st.st_size;
+
+		if (n == 0){
+		  cout << "Error: file " << path << " has length 0." << endl;
+		  exit(0);
+		}
+
+		void * addr = mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(addr == MAP_FAILED){
+		  cout << "Error while mapping file " << path <<endl;
+		  exit(0);
+		}
+
+		data = (symbol*)addr;
+
+		//hints only: failures are ignored
+		madvise(data, n, MADV_RANDOM);
+
+		rewind();
+
+	}
+
+	void rewind(){//go back to EOF
+
+		position = n-1;
+		block = position/PREFETCH_BLOCK;
+
+		begin_of_file=false;
+
+		prefetch(block);
+		if(block>0) prefetch(block-1);
+
+	}
+
+	symbol read(){
+
+		symbol s = data[position];
+
+		if(position==0){
+			begin_of_file=true;
+			return s;
+		}
+
+		if(position==block*PREFETCH_BLOCK){//entering block-1: prefetch the next one, release the one just read
+
+			release(block);
+
+			block--;
+
+			if(block>0) prefetch(block-1);
+
+		}
+
+		position--;
+
+		return s;
+
+	}
+
+	bool begin(){return begin_of_file;};//no more symbols to be read
+
+	void close(){munmap(data, n);::close(fd);};//unmap and close file
+
+	ulint length(){return n;};
+
+private:
+
+	static const ulint PREFETCH_BLOCK = ulint(1)<<24;//16 MiB, multiple of the page size
+
+	//[b*PREFETCH_BLOCK, (b+1)*PREFETCH_BLOCK) capped at n
+	ulint block_size(ulint b){
+
+		return std::min(PREFETCH_BLOCK, n-b*PREFETCH_BLOCK);
+
+	}
+
+	void prefetch(ulint b){
+
+		madvise(data+b*PREFETCH_BLOCK, block_size(b), MADV_WILLNEED);
+
+	}
+
+	void release(ulint b){
+
+		madvise(data+b*PREFETCH_BLOCK, block_size(b), MADV_DONTNEED);
+
+	}
+
+	ulint n;
+
+	bool begin_of_file;//begin of file reached
+
+	string path;
+
+	symbol * data;//the mapped file
+
+	ulint position;//position of the next symbol to be read
+	ulint block;//prefetch block containing position
+
+	int fd;//file descriptor
+
+
+};
+
+} /* namespace bwtil */
+
+#endif
+
+#endif /* BACKWARDMMAPITERATOR_H_ */
@@ -8,12 +8,23 @@
  *  Created on: Jan 15, 2016
  *      Author: nico
  *
- *  Dynamic FM-index. Supports LF mapping, backward search, locate, left-extend text
+ *  Dynamic FM-index. Supports LF mapping, backward search, locate, extract, left-extend text,
+ *  removal of the last text character (shrink: sliding windows)
  *
  *  Note that positions are enumerated from the end, where BWT terminator has
  *  position 0. e.g. in T = "abcd#", T[0] = # (where # is the BWT terminator)
+ *  shrink() removes T[1] (in the example, d): the positions of the remaining
+ *  characters decrease by one.
  *  Note: alphabet character 2^64-1 is reserved for the BWT terminator
  *
+ *  Collections: new_document() starts a new document, i.e. text extensions
+ *  after the call go to document 1, 2, ... (the first document has ID 0).
+ *  Each document after the first is ended by an implicit separator
+ *  (character 2^64-2, reserved) so that no occurrence spans two documents.
+ *  Positions inside documents are enumerated from the end as well: the end
+ *  marker (terminator or separator) of each document has offset 0.
+ *  Note: with the Huffman constructor, the separator must be included in P.
+ *
  *
  */
 
@@ -21,6 +32,11 @@
 #define INCLUDE_INTERNAL_FM_INDEX_HPP_
 
 #include "dynamic/internal/includes.hpp"
+#include "dynamic/internal/packed_vector.hpp"
+#include "dynamic/internal/spsi.hpp"
+#include "dynamic/internal/gap_bitvector.hpp"
+#include "dynamic/internal/succinct_bitvector.hpp"
+#include "dynamic/internal/wm_string.hpp"
 
 template <	class dyn_bwt,	//dynamic BWT
 			class dyn_bv,	//dynamic bitvector
@@ -33,6 +49,9 @@ public:
 	//we allow any alphabet
 	using char_type = ulint;
 
+	//implicit end marker of documents 1, 2, ...
+	static const char_type SEPARATOR = ~ulint(0)-1;
+
 	/*
 	 * Constructor #1
 	 *
@@ -44,6 +63,7 @@ public:
 
 		marked.insert(0,true);
 		SA.insert(0,0);
+		ISA.insert(0,0);
 		this->sample_rate = DEFAULT_SA_RATE;
 
 	}
@@ -60,6 +80,7 @@ public:
 
 		marked.insert(0,true);
 		SA.insert(0,0);
+		ISA.insert(0,0);
 		this->sample_rate = sample_rate;
 
 	}
@@ -77,6 +98,7 @@ public:
 
 		marked.insert(0,true);
 		SA.insert(0,0);
+		ISA.insert(0,0);
 		this->sample_rate = sample_rate;
 
 	}
@@ -99,12 +121,68 @@ public:
 	 * output: vector of corresponding positions on text. Note that
 	 * text positions are enumerated from the end, with
 	 * the BWT terminator (last character) having position 0.
+	 *
+	 * All rows of the range follow FL in lockstep. At each step, rows are
+	 * sorted: rows falling between the same two samples share the
+	 * rank/select on marked, and rows in the same run of F share the F
+	 * access in FL (see bwt::FL(vector)). A row stops as soon as it
+	 * hits a sample.
 	 */
 	vector<ulint> locate(pair<ulint,ulint> range) const {
 
-		auto res = vector<ulint>();
+		auto res = vector<ulint>(range.second > range.first ? range.second-range.first : 0);
+
+		//<row, index in res>, sorted by row
+		vector<pair<ulint,ulint> > lanes;
+		for(ulint i=range.first;i<range.second;++i) lanes.push_back({i,i-range.first});
+
+		const ulint n_marks = marked.rank1();
+
+		//number of FL steps performed by all lanes
+		ulint j = 0;
+
+		while(not lanes.empty()){
+
+			vector<pair<ulint,ulint> > active;
+
+			//m = number of marks before the current row, next = position of the m-th mark
+			ulint m = marked.rank1(lanes[0].first);
+			ulint next = m < n_marks ? marked.select1(m) : marked.size();
+
+			for(auto l : lanes){
+
+				if(l.first > next){
+
+					m = marked.rank1(l.first);
+					next = m < n_marks ? marked.select1(m) : marked.size();
+
+				}
+
+				if(l.first == next){
+
+					res[l.second] = sample_position(SA.at(m)) + j;
+
+				}else{
+
+					active.push_back(l);
+
+				}
+
+			}
+
+			vector<ulint> rows(active.size());
+			for(ulint k=0;k<active.size();++k) rows[k] = active[k].first;
+
+			rows = this->FL(rows);
+
+			for(ulint k=0;k<active.size();++k) active[k].first = rows[k];
+
+			std::sort(active.begin(),active.end());
+
+			lanes = std::move(active);
+			j++;
 
-		for(ulint i=range.first;i<range.second;++i) res.push_back(locate(i));
+		}
 
 		return res;
 
@@ -121,31 +199,485 @@ public:
 	}
 
 	/*
-	 * build FM index of cW from FM index of W
+	 * input: pattern P, maximum number k of errors. Errors are mismatches
+	 * (Hamming distance) or, if edits = true, mismatches, insertions and
+	 * deletions (edit distance).
+	 * output: number of text positions where an occurrence of P with at
+	 * most k errors starts. With edits, occurrences do not start or end with
+	 * a deletion (these would only be shifted copies of other occurrences)
+	 *
+	 * Backtracking backward search: branches are pruned with a lower bound
+	 * to the errors needed by the part of P still to be matched, computed
+	 * on the index before the search (see lower_bounds).
 	 */
-	void extend(char_type c){
+	ulint count_approx(vector<char_type> P, ulint k, bool edits = false) const {
 
-		dyn_bwt::extend(c);	//extend BWT
+		ulint cnt = 0;
+
+		for(auto range : approx_ranges(P, k, edits)) cnt += range.second - range.first;
+
+		return cnt;
+
+	}
+
+	/*
+	 * input: pattern P, maximum number k of errors (see count_approx)
+	 * output: text positions where an occurrence of P with at most k
+	 * errors starts (positions are enumerated from the end)
+	 */
+	vector<ulint> locate_approx(vector<char_type> P, ulint k, bool edits = false) const {
+
+		vector<ulint> res;
+
+		for(auto range : approx_ranges(P, k, edits)){
+
+			auto occ = locate(range);
+			res.insert(res.end(), occ.begin(), occ.end());
+
+		}
+
+		return res;
+
+	}
+
+	/*
+	 * input: pattern P
+	 * output: occurrences of P in the text, as pairs <document ID, offset in
+	 * the document>. Offsets are enumerated from the end of the document
+	 * (see document(pos))
+	 */
+	vector<pair<ulint,ulint> > locate_documents(vector<char_type> P) const {
+
+		auto occ = locate(P);
+
+		vector<pair<ulint,ulint> > res(occ.size());
+		for(ulint i=0;i<occ.size();++i) res[i] = document(occ[i]);
+
+		return res;
+
+	}
+
+	/*
+	 * input: text position pos
+	 * output: pair <document ID, offset of pos in the document>. The end marker
+	 * of document d lies at position document_start(d) and has offset 0
+	 */
+	pair<ulint,ulint> document(ulint pos) const {
+
+		assert(pos <= this->text_length());
+
+		//separators at positions <= pos. Positions after the
+		//last separator are not stored in docs
+		ulint d = pos < docs.size() ? docs.rank1(pos+1) : docs.rank1();
+
+		return {d, pos - document_start(d)};
+
+	}
+
+	/*
+	 * text position of the end marker of document d (the terminator for d=0,
+	 * a separator otherwise)
+	 */
+	ulint document_start(ulint d) const {
+
+		assert(d < number_of_documents());
+
+		return d == 0 ? 0 : docs.select1(d-1);
+
+	}
+
+	/*
+	 * number of characters of document d (end marker excluded)
+	 */
+	ulint document_length(ulint d) const {
+
+		ulint end = d+1 < number_of_documents() ? document_start(d+1) : this->text_length()+1;
+
+		return end - document_start(d) - 1;
+
+	}
+
+	/*
+	 * number of documents (at least 1)
+	 */
+	ulint number_of_documents() const {
+
+		return docs.rank1()+1;
+
+	}
+
+	/*
+	 * input: pattern P
+	 * output: the documents containing P, with the number of occurrences
+	 * of P in each of them (pairs <document ID, frequency>), by increasing
+	 * document ID. Time is proportional to the number of distinct documents
+	 * (not to the number of occurrences)
+	 */
+	vector<pair<ulint,ulint> > list_documents(vector<char_type> P) const {
+
+		auto range = dyn_bwt::count(P);
+
+		if(range.second <= range.first) return {};
+
+		//only one document: the document array is not built
+		if(DA.size() == 0) return {{0, range.second - range.first}};
+
+		return DA.range_distinct(range.first, range.second);
+
+	}
+
+	/*
+	 * input: pattern P and k
+	 * output: the (at most) k documents containing most occurrences of P, with
+	 * their number of occurrences (pairs <document ID, frequency>), by
+	 * decreasing frequency
+	 */
+	vector<pair<ulint,ulint> > top_k_documents(vector<char_type> P, ulint k) const {
+
+		auto range = dyn_bwt::count(P);
+
+		if(range.second <= range.first or k == 0) return {};
+
+		if(DA.size() == 0) return {{0, range.second - range.first}};
+
+		return DA.range_top_k(range.first, range.second, k);
+
+	}
+
+	/*
+	 * start a new document: the following calls to extend(c) add
+	 * characters to it. The new document is separated from the
+	 * previous ones by an implicit end marker
+	 */
+	void new_document(){
+
+		//the first time, all BWT rows belong to document 0
+		if(DA.size() == 0) DA = int_string(1, vector<ulint>(this->bwt_length(), 0));
+
+		//the sparse boundary bitvector stops at the last separator
+		ulint p = this->text_length()+1;
+		docs.insert0(docs.size(), p - docs.size());
+		docs.push_back(true);
+
+		//the separator belongs to the new document
+		extend_(SEPARATOR);
+
+	}
+
+	/*
+	 * build the index (must be empty) from the runs of the BWT of the text
+	 * (see bwt::build_from_run_stream). The rows are then visited with LF
+	 * from row 0 (the terminator suffix) to collect the SA/ISA samples:
+	 * O(n log n) time, O(n/sample_rate) words of extra space
+	 */
+	template<class run_source>
+	void build_from_run_stream(run_source next_run, char_type terminator, bool verbose=false){
+
+		assert(this->bwt_length()==1 and removed==0 and DA.size()==0);
+
+		dyn_bwt::build_from_run_stream(next_run, terminator, verbose);
+
+		if(verbose) cout << "Sampling the suffix array ..." << endl;
+
+		//<row, text position> of the SA samples
+		vector<pair<ulint,ulint> > samples;
+
+		ulint n = this->text_length();
+
+		for(ulint p=0, r=0;p<=n;++p){
+
+			if(p % sample_rate == 0) samples.push_back({r,p});
+			if(p<n) r = this->LF(r);
+
+		}
+
+		std::sort(samples.begin(),samples.end());
+
+		vector<ulint> ones, isa;
+
+		SA = dyn_vec();
+
+		for(auto x : samples){
+
+			ones.push_back(x.first);
+			SA.push_back(x.second);
+			isa.push_back(x.second/sample_rate);
+
+		}
+
+		marked = dyn_bv();
+		build_bv(marked, ones, this->bwt_length());
+
+		ISA = build_int_string(isa);
+
+	}
+
+	/*
+	 * build the index of the collection made of A's documents followed by
+	 * B's documents (this index must be empty): document d of B becomes
+	 * document A.number_of_documents()+d. This is the index that A would
+	 * become after new_document() and the extension with B's text, i.e.
+	 * the index of B·SEPARATOR·A (see bwt::merge). The sample rate is A's.
+	 *
+	 * The SA samples of A keep their text positions (their rows are shifted
+	 * by the rows of B inserted before them); the rows of B are visited with
+	 * LF from the row of SEPARATOR·A to sample them and to find their
+	 * documents. Time: O(|B| log n) + the time to write the BWT runs and
+	 * the document array (linear).
+	 */
+	void merge(const fm_index& A, const fm_index& B){
+
+		assert(this->bwt_length()==1);
+
+		//rows of B (with the separator in position 0 of B), sorted
+		auto rows_B = dyn_bwt::merge(A, B, SEPARATOR);
+
+		sample_rate = A.sample_rate;
+
+		//A's samples keep their values: the positions of A are numbered as in A
+		removed = A.removed;
+
+		//positions of B are shifted by the length of A (terminator included)
+		ulint nA = A.bwt_length();
 
 		/*
-		 * position of new suffix in the BWT
-		 * matrix (row number)
+		 * row of A's row x: the j-th row of B is preceded by
+		 * rows_B[j]-j rows of A (non-decreasing in j)
 		 */
-		auto tp = this->get_terminator_position();
+		auto row_of_A = [&](ulint x){
 
-		if(this->text_length() % sample_rate == 0){
+			ulint l = 0, r = rows_B.size();
 
-			marked.insert(tp,true);					//mark position with 1
-			SA.insert(marked.rank1(tp),this->text_length());	//insert SA sample
+			while(l<r){
 
-		}else{
+				ulint m = (l+r)/2;
 
-			marked.insert(tp,false);				//mark position with 0
+				if(rows_B[m]-m <= x) l = m+1;
+				else r = m;
+
+			}
+
+			return x+l;
+
+		};
+
+		//<row, text position> of the SA samples
+		vector<pair<ulint,ulint> > samples;
+
+		for(ulint i=0;i<A.SA.size();++i)
+			samples.push_back({row_of_A(A.marked.select1(i)),A.SA.at(i)});
+
+		//document of each row of B, in row order
+		vector<ulint> doc_B(rows_B.size());
+
+		//row of SEPARATOR·A: the row of A is preceded by the separator
+		ulint r = this->LF(row_of_A(A.get_terminator_position()));
+
+		for(ulint k=0;k<rows_B.size();++k){
+
+			if((nA+k+removed) % sample_rate == 0) samples.push_back({r,nA+k+removed});
+
+			ulint j = std::lower_bound(rows_B.begin(),rows_B.end(),r) - rows_B.begin();
+			doc_B[j] = A.number_of_documents() + B.document(k).first;
+
+			if(k+1<rows_B.size()) r = this->LF(r);
+
+		}
+
+		std::sort(samples.begin(),samples.end());
+
+		vector<ulint> ones, isa;
+
+		SA = dyn_vec();
+
+		for(auto x : samples){
+
+			ones.push_back(x.first);
+			SA.push_back(x.second);
+			isa.push_back(x.second/sample_rate);
+
+		}
+
+		marked = dyn_bv();
+		build_bv(marked, ones, this->bwt_length());
+
+		ISA = build_int_string(isa);
+
+		//separators of A, the one before B, separators of B
+		docs = {};
+
+		auto push_separator = [&](ulint p){
+
+			docs.insert0(docs.size(), p - docs.size());
+			docs.push_back(true);
+
+		};
+
+		for(ulint i=0;i<A.docs.rank1();++i) push_separator(A.docs.select1(i));
+		push_separator(nA);
+		for(ulint i=0;i<B.docs.rank1();++i) push_separator(B.docs.select1(i)+nA);
+
+		//document array: rows of A and B interleaved
+		vector<ulint> da(this->bwt_length());
+
+		for(ulint i=0, j=0, x=0;i<da.size();++i){
+
+			if(j<rows_B.size() and rows_B[j]==i) da[i] = doc_B[j++];
+			else da[i] = A.DA.size()>0 ? A.DA.at(x++) : (x++, 0);
+
+		}
+
+		DA = build_int_string(da);
+
+	}
+
+	/*
+	 * extract len characters starting from text position pos, i.e. the
+	 * characters in positions pos, pos-1, ..., pos-len+1 (positions are
+	 * enumerated from the end: the text is read from higher to lower
+	 * positions). Thus, extract(locate(P)[i], P.size(), buf) writes P in buf.
+	 *
+	 * Characters are written in buf[0,len) (converted to out_type).
+	 * We start from the nearest ISA sample at a position <= pos-len and
+	 * decode with LF: at most sample_rate + len LF steps (the samples removed
+	 * by shrink are replaced by the terminator, at position 0).
+	 */
+	template<typename out_type>
+	void extract(ulint pos, ulint len, out_type* buf) const {
+
+		assert(len <= pos and pos <= this->text_length());
+
+		if(len == 0) return;
+
+		//row of the suffix at position pos-len
+		ulint x = pos-len;
+
+		//samples are at positions multiple of sample_rate before the removals
+		ulint t = x == 0 ? 0 : (x+removed)/sample_rate;
+		if(t*sample_rate <= removed) t = 0;
+
+		ulint i = marked.select1(ISA.select(1,t)-1);
+
+		for(ulint j = t == 0 ? 0 : t*sample_rate-removed;j<x;++j) i = this->LF(i);
+
+		//L[i] is the character at position x+1, x+2, ...
+		for(ulint j=0;j<len;++j){
+
+			char_type c = this->at(i);
+			buf[len-1-j] = out_type(c);
+			i = this->LF(i,c);
 
 		}
 
 	}
 
+	/*
+	 * extract len characters starting from text position pos (see above)
+	 */
+	vector<char_type> extract(ulint pos, ulint len) const {
+
+		vector<char_type> res(len);
+		extract(pos, len, res.data());
+
+		return res;
+
+	}
+
+	/*
+	 * build FM index of cW from FM index of W
+	 */
+	void extend(char_type c){
+
+		assert(c != SEPARATOR);
+
+		extend_(c);
+
+	}
+
+	/*
+	 * build FM index of W from FM index of Wa: remove the character at
+	 * position 1, i.e. the first character given to extend among those still
+	 * in the text (see bwt::shrink). The SA samples, the document array and
+	 * the marks follow the rows reordered by the BWT. The first document
+	 * must not be empty: documents are not removed.
+	 */
+	void shrink(){
+
+		assert(this->text_length()>0);
+		assert(this->at(0) != SEPARATOR);
+
+		dyn_bwt::shrink(
+
+			[this](ulint i){
+
+				if(marked.at(i)){
+
+					ulint k = marked.rank1(i);
+					SA.remove(k);
+					ISA.remove(k);
+
+				}
+
+				marked.remove(i);
+
+				if(DA.size() > 0) DA.remove(i);
+
+			},
+
+			[this](ulint i, ulint j){
+
+				bool m = marked.at(i);
+				ulint v = 0, t = 0;
+
+				if(m){
+
+					ulint k = marked.rank1(i);
+					v = SA.at(k);
+					t = ISA.at(k);
+					SA.remove(k);
+					ISA.remove(k);
+
+				}
+
+				marked.remove(i);
+				marked.insert(j,m);
+
+				if(m){
+
+					ulint k = marked.rank1(j);
+					SA.insert(k,v);
+					ISA.insert(k,t);
+
+				}
+
+				if(DA.size() > 0){
+
+					ulint d = DA.at(i);
+					DA.remove(i);
+					DA.insert(j,d);
+
+				}
+
+			}
+
+		);
+
+		//separators are numbered from the end as well
+		if(docs.size() > 0) docs.remove(1);
+
+		removed++;
+
+	}
+
+	/*
+	 * number of characters removed with shrink
+	 */
+	ulint removed_characters() const {
+
+		return removed;
+
+	}
+
 	/*
 	 * Total number of bits allocated in RAM for this structure
 	 *
@@ -162,6 +694,9 @@ public:
 		size += dyn_bwt::bit_size();
 		size += marked.bit_size();
 		size += SA.bit_size();
+		size += ISA.bit_size();
+		size += docs.bit_size();
+		size += DA.bit_size();
 
 		return size;
 
@@ -176,8 +711,14 @@ public:
 		out.write((char*)&sample_rate,sizeof(sample_rate));
 		w_bytes += sizeof(sample_rate);
 
+		out.write((char*)&removed,sizeof(removed));
+		w_bytes += sizeof(removed);
+
 		w_bytes += marked.serialize(out);
 		w_bytes += SA.serialize(out);
+		w_bytes += ISA.serialize(out);
+		w_bytes += docs.serialize(out);
+		w_bytes += DA.serialize(out);
 
 		return w_bytes;
 
@@ -188,21 +729,263 @@ public:
 		dyn_bwt::load(in);
 
 		in.read((char*)&sample_rate,sizeof(sample_rate));
+		in.read((char*)&removed,sizeof(removed));
 
 		marked.load(in);
 		SA.load(in);
+		ISA.load(in);
+		docs.load(in);
+		DA.load(in);
 
 	}
 
 private:
 
+	//dynamic string of integers (ISA samples, document IDs)
+	typedef dyn::wm_string<dyn::succinct_bitvector<dyn::spsi<dyn::packed_bit_vector,256,16> > > int_string;
+
+	/*
+	 * extend the text with c (either a character or the separator)
+	 */
+	void extend_(char_type c){
+
+		dyn_bwt::extend(c);	//extend BWT
+
+		/*
+		 * position of new suffix in the BWT
+		 * matrix (row number)
+		 */
+		auto tp = this->get_terminator_position();
+
+		//position of the new suffix before the removals
+		ulint pos = this->text_length() + removed;
+
+		if(pos % sample_rate == 0){
+
+			marked.insert(tp,true);					//mark position with 1
+			SA.insert(marked.rank1(tp),pos);	//insert SA sample
+
+			//insert ISA sample: index of the new sample among text-ordered samples
+			ulint t = pos/sample_rate;
+			if(t >= ISA.sigma) ISA.add_level();
+			ISA.insert(marked.rank1(tp),t);
+
+		}else{
+
+			marked.insert(tp,false);				//mark position with 0
+
+		}
+
+		if(DA.size() > 0){
+
+			ulint d = number_of_documents()-1;
+			if(d >= DA.sigma) DA.add_level();
+			DA.insert(tp,d);
+
+		}
+
+	}
+
+	/*
+	 * bulk-build an int_string of the values in v. The alphabet is a power
+	 * of two, as extend_ doubles it with add_level when a value does not fit
+	 */
+	static int_string build_int_string(const vector<ulint>& v){
+
+		ulint b = 1;
+		for(auto x : v) while(x >> b) b++;
+
+		return int_string((ulint(1) << b) - 1, v);
+
+	}
+
+	/*
+	 * fill the empty bitvector B with n bits, set at the (sorted) positions
+	 * in ones. Generic version: one bit at a time
+	 */
+	template<class bv_type>
+	static void build_bv(bv_type& B, const vector<ulint>& ones, ulint n){
+
+		ulint j = 0;
+
+		for(ulint i=0;i<n;++i){
+
+			bool b = j<ones.size() and ones[j]==i;
+			B.push_back(b);
+			j += b;
+
+		}
+
+	}
+
+	/*
+	 * succinct bitvectors: bottom-up construction from words
+	 */
+	template<class spsi_type>
+	static void build_bv(dyn::succinct_bitvector<spsi_type>& B, const vector<ulint>& ones, ulint n){
+
+		vector<uint64_t> words(n/64+1,0);
+		for(auto i : ones) words[i/64] |= uint64_t(1) << (i%64);
+
+		B.push_words(words, n);
+
+	}
+
+	/*
+	 * gap-encoded bitvectors: one insertion per run of zeros
+	 */
+	template<class spsi_type>
+	static void build_bv(dyn::gap_bitvector<spsi_type>& B, const vector<ulint>& ones, ulint n){
+
+		for(auto i : ones){
+
+			B.insert0(B.size(), i - B.size());
+			B.push_back(true);
+
+		}
+
+		B.insert0(B.size(), n - B.size());
+
+	}
+
+	/*
+	 * backtracking backward search of P with at most k errors. Returns the
+	 * BWT ranges of the approximate occurrences, sorted and disjoint (the
+	 * same suffix may be reached by different alignments)
+	 */
+	vector<pair<ulint,ulint> > approx_ranges(const vector<char_type>& P, ulint k, bool edits) const {
+
+		vector<pair<ulint,ulint> > ranges;
+		approx_search(P, P.size(), {0,this->size()}, 0, k, edits, lower_bounds(P), ranges);
+
+		std::sort(ranges.begin(),ranges.end());
+
+		vector<pair<ulint,ulint> > res;
+
+		for(auto r : ranges){
+
+			if(r.second <= r.first) continue;
+
+			if(not res.empty() and r.first <= res.back().second)
+				res.back().second = std::max(res.back().second, r.second);
+			else
+				res.push_back(r);
+
+		}
+
+		return res;
+
+	}
+
+	/*
+	 * D[j] = lower bound to the number of errors in any occurrence of
+	 * P[0,j). P is greedily split, left to right, into pieces P[z,e] such
+	 * that P[z,e) occurs in the text and P[z,e] does not: each piece
+	 * contained in P[0,j) costs at least one error. The longest occurring
+	 * P[z,e) is found by binary search on its length.
+	 */
+	vector<ulint> lower_bounds(const vector<char_type>& P) const {
+
+		ulint m = P.size();
+		vector<ulint> D(m+1,0);
+
+		ulint z = 0;
+		ulint errors = 0;
+
+		while(z < m){
+
+			//longest occurring prefix of P[z,m) has length in [lo,hi]
+			ulint lo = 0, hi = m-z;
+
+			while(lo < hi){
+
+				ulint mid = (lo+hi+1)/2;
+				auto range = dyn_bwt::count(vector<char_type>(P.begin()+z, P.begin()+z+mid));
+
+				if(range.second > range.first) lo = mid;
+				else hi = mid-1;
+
+			}
+
+			//P[z,e] does not occur (if e < m)
+			ulint e = z + lo;
+
+			for(ulint j=z+1;j<=e and j<=m;++j) D[j] = errors;
+
+			if(e < m) D[e+1] = ++errors;
+
+			z = e+1;
+
+		}
+
+		return D;
+
+	}
+
+	/*
+	 * P[0,i) is still to be matched, range is the BWT range of the part
+	 * already matched, with e errors
+	 */
+	void approx_search(	const vector<char_type>& P, ulint i, pair<ulint,ulint> range, ulint e,
+						ulint k, bool edits, const vector<ulint>& D, vector<pair<ulint,ulint> >& res) const {
+
+		if(range.second <= range.first or e + D[i] > k) return;
+
+		//no more errors allowed: exact backward search
+		if(e == k){
+
+			for(;i>0 and range.second > range.first;--i) range = this->LF(range, P[i-1]);
+
+			res.push_back(range);
+			return;
+
+		}
+
+		if(i == 0){
+
+			res.push_back(range);
+			return;
+
+		}
+
+		//insertion: P[i-1] is not in the text
+		if(edits) approx_search(P, i-1, range, e+1, k, edits, D, res);
+
+		for(auto s : this->interval_symbols(range)){
+
+			//occurrences do not span documents
+			if(s.first == SEPARATOR) continue;
+
+			auto r = this->LF(range, s.first);
+
+			//match or mismatch
+			approx_search(P, i-1, r, e + (s.first != P[i-1]), k, edits, D, res);
+
+			//deletion: s is not in P. Deletions after the end of the
+			//occurrence give the same starting positions: skip them
+			if(edits and i < P.size()) approx_search(P, i, r, e+1, k, edits, D, res);
+
+		}
+
+	}
+
+	/*
+	 * current text position of a SA sample (samples store the positions
+	 * before the removals; the terminator does not move)
+	 */
+	ulint sample_position(ulint v) const {
+
+		return v == 0 ? 0 : v - removed;
+
+	}
+
 	/*
 	 * locate and add j
 	 */
 	ulint locate(ulint i, ulint j) const{
 
 		return 	marked.at(i) ?
-            SA.at(marked.rank1(i)) + j :
+            sample_position(SA.at(marked.rank1(i))) + j :
             locate( this->FL(i), j+1 );
 
 	}
@@ -210,8 +993,27 @@ private:
 	dyn_bv marked;	//is position i marked with a SA sample?
 	dyn_vec SA;		//suffix array sampling
 
+	/*
+	 * inverse suffix array sampling. The k-th SA sample (in BWT order) is
+	 * text position t*sample_rate, where t = ISA[k]: the row of position
+	 * t*sample_rate is marked.select1(ISA.select(1,t)-1). Rows shift when
+	 * the text is extended, so we store this permutation instead of rows
+	 */
+	int_string ISA = {1};
+
+	//separators (document boundaries) in text order, up to the last one
+	dyn::gap_bitvector<dyn::spsi<dyn::packed_vector,256,16> > docs;
+
+	/*
+	 * document array: document ID of each BWT row. Built at the first
+	 * new_document() call (empty as long as there is only one document)
+	 */
+	int_string DA;
+
 	ulint sample_rate;	//one SA sample out of sample_rate positions
 
+	ulint removed = 0;	//characters removed with shrink
+
 	static const ulint DEFAULT_SA_RATE = 256;
 
 };
@@ -0,0 +1,277 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * input_reader.hpp
+ *
+ *  Buffered reader used by the construction algorithms. The input stream
+ *  is read in large chunks and characters are served from a flat buffer,
+ *  instead of paying one (virtual) istream call per character. While
+ *  filling the buffer, the reader counts the bytes of each chunk, so that
+ *  character frequencies are available after a single pass.
+ *
+ *  Wide symbols (integer streams, tokenized text) are read with
+ *  get_symbol: 2, 4 or 8 little-endian bytes per symbol.
+ *
+ */
+
+#ifndef INCLUDE_INTERNAL_INPUT_READER_HPP_
+#define INCLUDE_INTERNAL_INPUT_READER_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn{
+
+class input_reader{
+
+public:
+
+	static const ulint DEFAULT_CHUNK_SIZE = 1<<20;
+
+	/*
+	 * in: input stream. The reader consumes it chunk by chunk, hence
+	 * characters must be read only through the reader.
+	 * count: if true, keep the byte histogram of the characters read
+	 */
+	input_reader(istream& in, bool count = false, ulint chunk_size = DEFAULT_CHUNK_SIZE) :
+		in(in), count(count), buf(chunk_size), counts(256,0){
+
+		assert(chunk_size > 0);
+
+	}
+
+	/*
+	 * next character. Returns false at the end of the stream
+	 */
+	bool get(char& c){
+
+		if(pos == end and not fill()) return false;
+
+		c = buf[pos++];
+
+		return true;
+
+	}
+
+	/*
+	 * next symbol of the given number of bytes (1, 2, 4 or 8), little-endian.
+	 * Returns false at the end of the stream (a trailing incomplete symbol
+	 * is discarded)
+	 */
+	bool get_symbol(ulint& c, ulint symbol_bytes){
+
+		assert(symbol_bytes == 1 or symbol_bytes == 2 or symbol_bytes == 4 or symbol_bytes == 8);
+
+		if(symbol_bytes == 1){
+
+			char x;
+
+			if(not get(x)) return false;
+
+			c = uchar(x);
+			return true;
+
+		}
+
+		uint8_t b[8];
+
+		if(not read((char*)b, symbol_bytes)) return false;
+
+		c = 0;
+		for(ulint i=0;i<symbol_bytes;++i) c |= ulint(b[i]) << (8*i);
+
+		return true;
+
+	}
+
+	/*
+	 * read n bytes into dst. Returns false (and reads nothing) if less
+	 * than n bytes are left
+	 */
+	bool read(char* dst, ulint n){
+
+		if(end - pos < n){
+
+			//move the tail to the beginning of the buffer and refill
+			std::copy(buf.begin()+pos, buf.begin()+end, buf.begin());
+			end -= pos;
+			pos = 0;
+
+			if(buf.size() < n) buf.resize(n);
+
+			while(end < n and fill_from(end));
+
+			if(end < n) return false;
+
+		}
+
+		std::copy(buf.begin()+pos, buf.begin()+pos+n, dst);
+		pos += n;
+
+		return true;
+
+	}
+
+	/*
+	 * read the whole stream. Returns the number of bytes read
+	 */
+	ulint skip_all(){
+
+		while(pos < end or fill()) pos = end;
+
+		return bytes();
+
+	}
+
+	/*
+	 * number of bytes consumed so far
+	 */
+	ulint bytes() const {
+
+		return loaded - (end - pos);
+
+	}
+
+	/*
+	 * number of occurrences of each byte in the loaded chunks (all the
+	 * stream after skip_all()). Available only if count = true
+	 */
+	const vector<ulint>& byte_counts() const {
+
+		assert(count);
+		return counts;
+
+	}
+
+private:
+
+	/*
+	 * replace the buffer with the next chunk
+	 */
+	bool fill(){
+
+		pos = 0;
+		end = 0;
+
+		return fill_from(0);
+
+	}
+
+	/*
+	 * read the next chunk in buf[from,buf.size())
+	 */
+	bool fill_from(ulint from){
+
+		in.read(buf.data()+from, buf.size()-from);
+		ulint n = in.gcount();
+
+		if(count) histogram(buf.data()+from, n);
+
+		end = from+n;
+		loaded += n;
+
+		return n > 0;
+
+	}
+
+	/*
+	 * byte histogram with 4 interleaved tables: consecutive equal bytes
+	 * (frequent in repetitive texts) increment different counters, so
+	 * the increments do not wait on each other
+	 */
+	void histogram(const char* data, ulint n){
+
+		ulint h[4][256] = {};
+
+		ulint i = 0;
+
+		for(;i+4<=n;i+=4){
+
+			h[0][uchar(data[i])]++;
+			h[1][uchar(data[i+1])]++;
+			h[2][uchar(data[i+2])]++;
+			h[3][uchar(data[i+3])]++;
+
+		}
+
+		for(;i<n;++i) h[0][uchar(data[i])]++;
+
+		for(ulint c=0;c<256;++c) counts[c] += h[0][c] + h[1][c] + h[2][c] + h[3][c];
+
+	}
+
+	istream& in;
+	bool count;
+
+	vector<char> buf;
+
+	//characters in buf[pos,end) are still to be read
+	ulint pos = 0;
+	ulint end = 0;
+
+	//bytes loaded from the stream so far
+	ulint loaded = 0;
+
+	vector<ulint> counts;
+
+};
+
+}
+
+/*
+ * input: an input stream of characters
+ * output: character frequencies
+ */
+inline vector<pair<ulint,double> > get_frequencies(istream& in){
+
+	dyn::input_reader reader(in, true);
+
+	ulint size = reader.skip_all();
+	auto& counts = reader.byte_counts();
+
+	vector<pair<ulint,double> > res;
+
+	for(ulint i=0;i<256;++i){
+
+		res.push_back({i,double(counts[i])/size});
+
+		//if(counts[i]>0)	cout << uchar(i) << " -> " << double(counts[i])/size << endl;
+
+	}
+
+	return res;
+
+}
+
+/*
+ * input: an input stream of symbols of symbol_bytes bytes each (see
+ * input_reader::get_symbol)
+ * output: frequencies of the symbols occurring in the stream
+ */
+inline vector<pair<ulint,double> > get_frequencies(istream& in, ulint symbol_bytes){
+
+	if(symbol_bytes == 1) return get_frequencies(in);
+
+	dyn::input_reader reader(in);
+
+	std::map<ulint,ulint> counts;
+	ulint size = 0;
+
+	ulint c;
+	while(reader.get_symbol(c, symbol_bytes)){
+
+		counts[c]++;
+		size++;
+
+	}
+
+	vector<pair<ulint,double> > res;
+
+	for(auto e : counts) res.push_back({e.first,double(e.second)/size});
+
+	return res;
+
+}
+
+#endif /* INCLUDE_INTERNAL_INPUT_READER_HPP_ */
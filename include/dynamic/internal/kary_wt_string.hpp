@@ -0,0 +1,396 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * kary_wt_string.hpp
+ *
+ *  Dynamic string supporting rank, select, access, insert, remove.
+ *
+ *  Multi-ary wavelet tree: each node stores a packed_symbol_vector of W-bit
+ *  digits (with per-symbol counters in its internal nodes), so that a node
+ *  replaces W levels of a binary wavelet tree. With W=2, alphabets of size
+ *  <= 4 (e.g. DNA) need a single B-tree descent per access/rank/insert, and
+ *  alphabets of size <= 16 need two.
+ *
+ *  Characters are assigned codes 0,1,2,... in order of appearance. Codes are
+ *  written in base 2^W using as many digits (tree levels) as needed: when the
+ *  alphabet grows beyond the current capacity a new level is added on top of
+ *  the tree (linear time, happens at most log_{2^W} sigma times).
+ *
+ */
+
+#ifndef INCLUDE_INTERNAL_KARY_WT_STRING_HPP_
+#define INCLUDE_INTERNAL_KARY_WT_STRING_HPP_
+
+#include <array>
+
+#include "dynamic/internal/includes.hpp"
+#include "dynamic/internal/packed_symbol_vector.hpp"
+
+namespace dyn {
+
+template <class symbol_vector_t>
+class kary_wt_string {
+ public:
+  // we allow any alphabet
+  typedef uint64_t char_type;
+  typedef char_type value_type;
+
+  /*
+   * Constructor #1
+   *
+   * Alphabet is unknown. The tree starts with one level and grows when needed
+   *
+   */
+  kary_wt_string() {}
+
+  /*
+   * Constructor #2
+   *
+   * We know only alphabet size: the tree is created with the right number of
+   * levels.
+   *
+   */
+  explicit kary_wt_string(uint64_t sigma) {
+    assert(sigma > 0);
+    while (capacity() < sigma) ++levels_;
+  }
+
+  /*
+   * Constructor #3
+   *
+   * We know character probabilities. Input: pairs <character, probability>.
+   * Probabilities are ignored: characters are given codes in order of
+   * appearance in P.
+   *
+   */
+  explicit kary_wt_string(vector<pair<char_type, double>>& P) : kary_wt_string(P.size()) {
+    for (auto p : P) encode(p.first);
+  }
+
+  kary_wt_string(const kary_wt_string& other) { *this = other; }
+
+  kary_wt_string& operator=(const kary_wt_string& other) {
+    if (this != &other) {
+      n = other.n;
+      levels_ = other.levels_;
+      encode_ = other.encode_;
+      decode_ = other.decode_;
+      root = other.root;
+    }
+    return *this;
+  }
+
+  uint64_t size() const { return n; }
+
+  char_type operator[](uint64_t i) const { return at(i); }
+
+  /*
+   * access: one descent per level, symbol and rank are computed together
+   */
+  char_type at(uint64_t i) const {
+    assert(i < size());
+
+    const node* x = &root;
+    uint64_t code = 0;
+
+    for (uint64_t l = 0; l < levels_; ++l) {
+      auto sr = x->seq.at_rank(i);
+
+      code = (code << W) | sr.first;
+      i = sr.second;
+
+      if (l + 1 < levels_) x = x->child(sr.first);
+    }
+
+    return decode_[code];
+  }
+
+  /*
+   * number of chars equal to c before position i EXCLUDED
+   */
+  uint64_t rank(uint64_t i, char_type c) const {
+    assert(i <= size());
+
+    auto it = encode_.find(c);
+    if (it == encode_.end()) return 0;
+
+    uint64_t code = it->second;
+    const node* x = &root;
+
+    for (uint64_t l = 0; l < levels_ and x; ++l) {
+      uint64_t d = digit(code, l);
+      i = x->seq.rank(i, d);
+
+      if (l + 1 < levels_) x = x->child(d);
+    }
+
+    return x ? i : 0;
+  }
+
+  /*
+   * position of i-th character equal to c. 0 =< i < rank(size(),c)
+   */
+  uint64_t select(uint64_t i, char_type c) const {
+    assert(char_exists(c));
+    assert(i < rank(size(), c));
+
+    uint64_t code = encode_.at(c);
+
+    // top-down: collect the path to the leaf level
+    vector<const node*> path;
+    const node* x = &root;
+
+    for (uint64_t l = 0; l < levels_; ++l) {
+      path.push_back(x);
+      if (l + 1 < levels_) x = x->child(digit(code, l));
+    }
+
+    // bottom-up: select on each level
+    for (uint64_t l = levels_; l > 0; --l) i = path[l - 1]->seq.select(i, digit(code, l - 1));
+
+    return i;
+  }
+
+  bool char_exists(char_type c) const { return encode_.find(c) != encode_.end(); }
+
+  void push_back(char_type c) { insert(size(), c); }
+
+  void push_front(char_type c) { insert(0, c); }
+
+  /*
+   * insert a character at position i. Each level costs one descent: the
+   * rank needed to go down is computed while inserting.
+   */
+  void insert(uint64_t i, char_type c) {
+    assert(i <= size());
+
+    uint64_t code = encode(c);
+    node* x = &root;
+
+    for (uint64_t l = 0; l < levels_; ++l) {
+      uint64_t d = digit(code, l);
+      i = x->seq.insert(i, d);
+
+      if (l + 1 < levels_) x = x->child_or_create(d);
+    }
+
+    ++n;
+  }
+
+  /*
+   * remove character at position i
+   */
+  void remove(uint64_t i) {
+    assert(i < size());
+
+    node* x = &root;
+
+    for (uint64_t l = 0; l < levels_; ++l) {
+      auto sr = x->seq.remove(i);
+      i = sr.second;
+
+      if (l + 1 < levels_) x = x->child_or_create(sr.first);
+    }
+
+    --n;
+  }
+
+  uint64_t bit_size() const {
+    uint64_t size = sizeof(kary_wt_string) * 8;
+    size += decode_.capacity() * sizeof(char_type) * 8;
+    size += encode_.size() * 2 * sizeof(uint64_t) * 8;
+    size += root.bit_size();
+    return size;
+  }
+
+  ulint alphabet_size() const { return decode_.size(); }
+
+  ulint serialize(ostream& out) const {
+    ulint w_bytes = 0;
+
+    out.write((char*)&n, sizeof(n));
+    w_bytes += sizeof(n);
+
+    out.write((char*)&levels_, sizeof(levels_));
+    w_bytes += sizeof(levels_);
+
+    ulint sigma = decode_.size();
+    out.write((char*)&sigma, sizeof(sigma));
+    w_bytes += sizeof(sigma);
+
+    out.write((char*)decode_.data(), sigma * sizeof(char_type));
+    w_bytes += sigma * sizeof(char_type);
+
+    w_bytes += root.serialize(out);
+
+    return w_bytes;
+  }
+
+  void load(istream& in) {
+    in.read((char*)&n, sizeof(n));
+    in.read((char*)&levels_, sizeof(levels_));
+
+    ulint sigma;
+    in.read((char*)&sigma, sizeof(sigma));
+
+    decode_ = vector<char_type>(sigma);
+    in.read((char*)decode_.data(), sigma * sizeof(char_type));
+
+    encode_.clear();
+    for (ulint code = 0; code < sigma; ++code) encode_[decode_[code]] = code;
+
+    root = node();
+    root.load(in);
+  }
+
+ private:
+  static constexpr uint64_t W = symbol_vector_t::WIDTH;
+  static constexpr uint64_t ARITY = symbol_vector_t::SIGMA;
+
+  class node {
+   public:
+    node() {}
+
+    node(const node& other) : seq(other.seq) {
+      for (uint64_t d = 0; d < ARITY; ++d)
+        if (other.children[d]) children[d] = new node(*other.children[d]);
+    }
+
+    node& operator=(const node& other) {
+      if (this != &other) {
+        clear();
+        seq = other.seq;
+        for (uint64_t d = 0; d < ARITY; ++d)
+          if (other.children[d]) children[d] = new node(*other.children[d]);
+      }
+      return *this;
+    }
+
+    node& operator=(node&& other) {
+      if (this != &other) {
+        clear();
+        seq = std::move(other.seq);
+        children = other.children;
+        other.children.fill(nullptr);
+      }
+      return *this;
+    }
+
+    ~node() { clear(); }
+
+    const node* child(uint64_t d) const { return children[d]; }
+
+    node* child_or_create(uint64_t d) {
+      if (not children[d]) children[d] = new node();
+      return children[d];
+    }
+
+    /*
+     * make this node the 0-child of a new node storing size 0-digits
+     */
+    void push_down(uint64_t size) {
+      node* x = new node();
+      x->seq = std::move(seq);
+      x->children = children;
+
+      children.fill(nullptr);
+      children[0] = x;
+
+      seq = symbol_vector_t();
+      seq.append_words(vector<uint64_t>((size * W + 63) / 64, 0), size);
+    }
+
+    ulint bit_size() const {
+      ulint size = sizeof(node) * 8 + seq.bit_size();
+      for (auto c : children)
+        if (c) size += c->bit_size();
+      return size;
+    }
+
+    ulint serialize(ostream& out) const {
+      ulint w_bytes = seq.serialize(out);
+
+      for (auto c : children) {
+        bool has_child = c;
+        out.write((char*)&has_child, sizeof(has_child));
+        w_bytes += sizeof(has_child);
+
+        if (c) w_bytes += c->serialize(out);
+      }
+
+      return w_bytes;
+    }
+
+    void load(istream& in) {
+      seq.load(in);
+
+      for (auto& c : children) {
+        bool has_child;
+        in.read((char*)&has_child, sizeof(has_child));
+
+        if (has_child) {
+          c = new node();
+          c->load(in);
+        }
+      }
+    }
+
+    symbol_vector_t seq;
+
+   private:
+    void clear() {
+      for (auto& c : children) {
+        delete c;
+        c = nullptr;
+      }
+    }
+
+    std::array<node*, ARITY> children{};
+  };
+
+  // number of distinct codes representable with the current number of levels
+  uint64_t capacity() const { return levels_ * W >= 64 ? ~uint64_t(0) : uint64_t(1) << (levels_ * W); }
+
+  // l-th base-2^W digit of code, most significant first
+  uint64_t digit(uint64_t code, uint64_t l) const {
+    return (code >> ((levels_ - 1 - l) * W)) & (ARITY - 1);
+  }
+
+  /*
+   * get code of c. If c is new, a code is created (and a level is added
+   * to the tree if needed)
+   */
+  uint64_t encode(char_type c) {
+    auto it = encode_.find(c);
+    if (it != encode_.end()) return it->second;
+
+    uint64_t code = decode_.size();
+
+    if (code >= capacity()) {
+      root.push_down(n);
+      ++levels_;
+    }
+
+    encode_[c] = code;
+    decode_.push_back(c);
+
+    return code;
+  }
+
+  // current length
+  ulint n = 0;
+
+  // number of levels (base-2^W digits of each code)
+  ulint levels_ = 1;
+
+  tsl::hopscotch_map<char_type, uint64_t> encode_;
+  vector<char_type> decode_;
+
+  node root;
+};
+
+}  // namespace dyn
+
+#endif /* INCLUDE_INTERNAL_KARY_WT_STRING_HPP_ */
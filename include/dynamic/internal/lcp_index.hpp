@@ -0,0 +1,415 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * lcp_index.hpp
+ *
+ *  Dynamic FM index with a run-length sampled LCP array. Supports, on top of
+ *  the FM index, lcp(i), string depth, parent and suffix link of suffix tree
+ *  nodes (represented as BWT intervals), left-extend text.
+ *
+ *  LCP[i] is the length of the longest common prefix between the suffixes in
+ *  rows i-1 and i (LCP[0] = 0). We store LCP only at the BWT rows that start
+ *  a run of L (O(r) values). If L[i-1] = L[i] = c, then rows LF(i-1) and
+ *  LF(i) are consecutive and their suffixes are those of i-1 and i preceded
+ *  by c: LCP[i] = LCP[LF(i)] - 1. Hence LCP[i] = LCP[LF^k(i)] - k, where
+ *  LF^k(i) is the first run head met by LF (the terminator row is a run head).
+ *
+ *  Left-extending the text does not change the existing suffixes: only the
+ *  LCP values of the new row and of the following row change, and only the
+ *  rows around the new row and the old terminator row can start/stop a run.
+ *  The two new values are computed on the old index with the FL function,
+ *  from the closest rows above/below the old terminator row ending with the
+ *  new character.
+ *
+ *  Note: alphabet character 2^64-1 is reserved for the BWT terminator
+ *
+ */
+
+#ifndef INCLUDE_INTERNAL_LCP_INDEX_HPP_
+#define INCLUDE_INTERNAL_LCP_INDEX_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn{
+
+template <	class dyn_fmi,	//dynamic FM index (should be run-length encoded)
+			class dyn_bv,	//dynamic bitvector (should be gap-encoded)
+			class dyn_vec	//dynamic vector
+		>
+class lcp_index : public dyn_fmi{
+
+public:
+
+	//we allow any alphabet
+	using char_type = ulint;
+
+	/*
+	 * Constructor #1
+	 *
+	 * Alphabet is unknown. Characters are gamma-coded.
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	lcp_index(){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #2
+	 *
+	 * We know only alphabet size. Each character is assigned log2(sigma) bits.
+	 * Characters are assigned codes 0,1,2,... in order of appearance
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	lcp_index(uint64_t sigma, ulint sample_rate = DEFAULT_SA_RATE) : dyn_fmi(sigma, sample_rate){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #3
+	 *
+	 * We know character probabilities. Input: pairs <character, probability>
+	 *
+	 * Here the alphabet is Huffman encoded.
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	lcp_index(vector<pair<char_type,double> >& P, ulint sample_rate = DEFAULT_SA_RATE) : dyn_fmi(P, sample_rate){
+
+		init();
+
+	}
+
+	/*
+	 * length of the longest common prefix between the suffixes in rows i-1
+	 * and i (0 for i=0)
+	 */
+	ulint lcp(ulint i) const {
+
+		assert(i < this->bwt_length());
+
+		ulint k = 0;
+
+		while(not heads.at(i)){
+
+			i = this->LF(i);
+			k++;
+
+		}
+
+		return LCP.at(heads.rank1(i)) - k;
+
+	}
+
+	/*
+	 * input: BWT interval [l,r) of a suffix tree node (r > l)
+	 * output: string depth of the node. For leaves this is the length of
+	 * the suffix (terminator excluded), for internal nodes the longest
+	 * common prefix of the suffixes in rows l and r-1.
+	 */
+	ulint string_depth(pair<ulint,ulint> I) const {
+
+		assert(I.first < I.second and I.second <= this->bwt_length());
+
+		return I.second - I.first == 1 ? this->locate(I.first) : lce(I.first, I.second-1);
+
+	}
+
+	/*
+	 * input: BWT interval [l,r) of a suffix tree node (r > l)
+	 * output: BWT interval of its parent (the root is its own parent)
+	 *
+	 * The parent's string depth is max(LCP[l], LCP[r]); its interval is
+	 * found with backward search of the corresponding prefix of the suffix
+	 * in row l (read with FL).
+	 */
+	pair<ulint,ulint> parent(pair<ulint,ulint> I) const {
+
+		assert(I.first < I.second and I.second <= this->bwt_length());
+
+		ulint d = std::max(	I.first > 0 ? lcp(I.first) : 0,
+							I.second < this->bwt_length() ? lcp(I.second) : 0);
+
+		return this->count(prefix(I.first, 0, d));
+
+	}
+
+	/*
+	 * input: BWT interval [l,r) of a suffix tree node (r > l)
+	 * output: BWT interval of the node whose string is that of the input
+	 * node without its first character (the root is returned for the root)
+	 */
+	pair<ulint,ulint> suffix_link(pair<ulint,ulint> I) const {
+
+		assert(I.first < I.second and I.second <= this->bwt_length());
+
+		//leaves: the next suffix
+		if(I.second - I.first == 1){
+
+			ulint j = this->FL(I.first);
+			return {j,j+1};
+
+		}
+
+		ulint d = string_depth(I);
+
+		if(d == 0) return I;
+
+		return this->count(prefix(I.first, 1, d));
+
+	}
+
+	/*
+	 * build index of cW from index of W
+	 */
+	void extend(char_type c){
+
+		auto v = new_values(c);
+
+		dyn_fmi::extend(c);
+
+		update(v);
+
+	}
+
+	/*
+	 * start a new document (see fm_index)
+	 */
+	void new_document(){
+
+		auto v = new_values(dyn_fmi::SEPARATOR);
+
+		dyn_fmi::new_document();
+
+		update(v);
+
+	}
+
+	/*
+	 * number of LCP samples (equal to the number of runs of L, the
+	 * terminator splitting its run)
+	 */
+	ulint number_of_samples() const {
+
+		return LCP.size();
+
+	}
+
+	/*
+	 * Total number of bits allocated in RAM for this structure
+	 *
+	 * WARNING: this measure is good only for relatively small alphabets (e.g. ASCII)
+	 * as we use STL containers such as set and map which do not give direct info on
+	 * the total memory allocated. The sizes of these containers are proportional
+	 * to the alphabet size (but the constants involved are high since internally
+	 * they can use heavy structures as RBT)
+	 */
+	ulint bit_size() const {
+
+		ulint size = sizeof(lcp_index<dyn_fmi,dyn_bv,dyn_vec>)*8;
+
+		size += dyn_fmi::bit_size();
+		size += heads.bit_size();
+		size += LCP.bit_size();
+
+		return size;
+
+	}
+
+	ulint serialize(ostream &out) const {
+
+		ulint w_bytes=0;
+
+		w_bytes += dyn_fmi::serialize(out);
+
+		w_bytes += heads.serialize(out);
+		w_bytes += LCP.serialize(out);
+
+		return w_bytes;
+
+	}
+
+	void load(istream &in){
+
+		dyn_fmi::load(in);
+
+		heads.load(in);
+		LCP.load(in);
+
+	}
+
+private:
+
+	//merging is not supported: the LCP samples would not be built
+	using dyn_fmi::merge;
+
+	static const ulint DEFAULT_SA_RATE = 256;
+
+	/*
+	 * LCP values that change (or start being sampled) when the text is
+	 * extended, computed on the index before the extension
+	 */
+	struct lcp_update{
+
+		ulint t;		//old terminator row (row of W)
+		ulint pred;		//LCP between the new suffix and its predecessor
+		ulint succ;		//LCP between the new suffix and its successor
+		ulint lcp_t;	//LCP[t]
+		ulint lcp_t1;	//LCP[t+1] (0 if t is the last row)
+
+	};
+
+	/*
+	 * only the terminator: row 0 is the head of the only run
+	 */
+	void init(){
+
+		heads.insert(0,true);
+		LCP.insert(0,0);
+
+	}
+
+	/*
+	 * the new suffix cW goes in row r (old coordinates). Its predecessor
+	 * (resp. successor) starts with c iff there is a c above (resp. below)
+	 * the row t of W in L. In that case it is c followed by the suffix
+	 * of the closest such row a (resp. b), i.e. FL(r-1) (resp. FL(r)).
+	 */
+	lcp_update new_values(char_type c) const {
+
+		ulint N = this->bwt_length();
+		ulint t = this->get_terminator_position();
+
+		lcp_update v = {t, 0, 0, t > 0 ? lcp(t) : 0, t+1 < N ? lcp(t+1) : 0};
+
+		auto block = this->LF({0,N},c);
+
+		if(block.second <= block.first) return v;
+
+		ulint r = this->LF(t,c);
+
+		if(r > block.first) v.pred = 1 + lce(this->FL(r-1), t);
+		if(r < block.second) v.succ = 1 + lce(t, this->FL(r));
+
+		return v;
+
+	}
+
+	/*
+	 * update run heads and LCP samples after the extension
+	 */
+	void update(const lcp_update& v){
+
+		ulint N = this->bwt_length();
+		ulint tp = this->get_terminator_position();
+
+		//row of W in the new BWT (it now ends with the new character)
+		ulint u = v.t < tp ? v.t : v.t+1;
+
+		//the new row ends with the terminator: it is the head of a run
+		heads.insert(tp,true);
+		LCP.insert(heads.rank1(tp),v.pred);
+
+		//the row after the terminator is the head of a run
+		if(tp+1 < N) set_row(tp+1, v.succ);
+
+		if(u != tp+1) set_row(u, v.lcp_t);
+
+		if(u+1 < N and u+1 != tp and u+1 != tp+1) set_row(u+1, v.lcp_t1);
+
+	}
+
+	/*
+	 * row i has LCP value lcp: mark/unmark i as head of a run of L
+	 */
+	void set_row(ulint i, ulint lcp){
+
+		bool head = i == 0 or this->at(i) != this->at(i-1);
+
+		if(heads.at(i)){
+
+			if(head){
+
+				LCP.set(heads.rank1(i),lcp);
+
+			}else{
+
+				LCP.remove(heads.rank1(i));
+				heads.remove(i);
+				heads.insert(i,false);
+
+			}
+
+		}else if(head){
+
+			heads.remove(i);
+			heads.insert(i,true);
+			LCP.insert(heads.rank1(i),lcp);
+
+		}
+
+	}
+
+	/*
+	 * longest common prefix of the suffixes in rows x < y. Suffixes are
+	 * compared with F and FL (which keeps their order) until the rows
+	 * become consecutive, where the LCP array is used
+	 */
+	ulint lce(ulint x, ulint y) const {
+
+		assert(x < y);
+
+		ulint k = 0;
+
+		while(y != x+1){
+
+			char_type c = this->F_at(x);
+
+			if(x == 0 or c != this->F_at(y)) return k;
+
+			x = this->FL(x);
+			y = this->FL(y);
+			k++;
+
+		}
+
+		return k + lcp(y);
+
+	}
+
+	/*
+	 * characters [from,to) of the suffix in row i
+	 */
+	vector<char_type> prefix(ulint i, ulint from, ulint to) const {
+
+		vector<char_type> P;
+
+		for(ulint k=0;k<to;++k){
+
+			if(k >= from) P.push_back(this->F_at(i));
+			i = this->FL(i);
+
+		}
+
+		return P;
+
+	}
+
+	//marks BWT rows that are heads of runs of L (row-indexed)
+	dyn_bv heads;
+
+	//LCP values of run heads, in BWT order
+	dyn_vec LCP;
+
+};
+
+}
+
+#endif /* INCLUDE_INTERNAL_LCP_INDEX_HPP_ */
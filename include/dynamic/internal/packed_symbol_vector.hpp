@@ -0,0 +1,746 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * packed_symbol_vector.hpp
+ *
+ *  Dynamic sequence of W-bit symbols (W in {1,2,4,8}) supporting access,
+ *  rank, select, insert and remove in a single root-to-leaf descent.
+ *
+ *  The structure is a B+-tree: leaves store up to 2*B_LEAF symbols packed in
+ *  64-bit words, internal nodes store, for each child, its size and one
+ *  counter per symbol. This is the building block of the multi-ary wavelet
+ *  tree (kary_wt_string): one node of such a tree replaces W levels of a
+ *  binary wavelet tree.
+ *
+ */
+
+#ifndef INTERNAL_PACKED_SYMBOL_VECTOR_HPP_
+#define INTERNAL_PACKED_SYMBOL_VECTOR_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn {
+
+template <uint8_t W = 2, uint32_t B_LEAF = 4096, uint32_t B = 16>
+class packed_symbol_vector {
+  static_assert(W == 1 or W == 2 or W == 4 or W == 8,
+                "symbol width must be 1, 2, 4 or 8 bits");
+  static_assert(B_LEAF >= 64 and B >= 2, "leaves/nodes are too small");
+
+ public:
+  // number of distinct symbols
+  static constexpr uint64_t SIGMA = uint64_t(1) << W;
+
+  static constexpr uint8_t WIDTH = W;
+
+  packed_symbol_vector() { root = new node(); }
+
+  ~packed_symbol_vector() { delete root; }
+
+  packed_symbol_vector(const packed_symbol_vector& other) { *this = other; }
+
+  packed_symbol_vector(packed_symbol_vector&& other) { *this = std::move(other); }
+
+  packed_symbol_vector& operator=(const packed_symbol_vector& other) {
+    if (this != &other) {
+      delete root;
+      root = new node(*other.root);
+    }
+    return *this;
+  }
+
+  packed_symbol_vector& operator=(packed_symbol_vector&& other) {
+    if (this != &other) {
+      delete root;
+      root = other.root;
+      other.root = new node();
+    }
+    return *this;
+  }
+
+  uint64_t size() const { return root->size(); }
+
+  /*
+   * number of symbols equal to c in the whole sequence
+   */
+  uint64_t count(uint64_t c) const {
+    assert(c < SIGMA);
+    return root->count(c);
+  }
+
+  uint64_t at(uint64_t i) const {
+    assert(i < size());
+    return root->at(i);
+  }
+
+  uint64_t operator[](uint64_t i) const { return at(i); }
+
+  /*
+   * returns the pair <S[i], rank(i,S[i])> with one descent
+   */
+  pair<uint64_t, uint64_t> at_rank(uint64_t i) const {
+    assert(i < size());
+    return root->at_rank(i);
+  }
+
+  /*
+   * number of symbols equal to c before position i EXCLUDED
+   */
+  uint64_t rank(uint64_t i, uint64_t c) const {
+    assert(i <= size());
+    assert(c < SIGMA);
+    return root->rank(i, c);
+  }
+
+  /*
+   * position of the i-th symbol equal to c. 0 <= i < count(c)
+   */
+  uint64_t select(uint64_t i, uint64_t c) const {
+    assert(c < SIGMA);
+    assert(i < count(c));
+    return root->select(i, c);
+  }
+
+  /*
+   * insert symbol c at position i. Returns rank(i,c), i.e. the number of
+   * symbols equal to c that precede the inserted one.
+   */
+  uint64_t insert(uint64_t i, uint64_t c) {
+    assert(i <= size());
+    assert(c < SIGMA);
+
+    uint64_t r = 0;
+    node* sibling = root->insert(i, c, r);
+
+    if (sibling) new_root(sibling);
+
+    return r;
+  }
+
+  void push_back(uint64_t c) { insert(size(), c); }
+
+  /*
+   * remove the symbol at position i. Returns the pair
+   * <S[i], rank(i,S[i])> computed before the removal.
+   */
+  pair<uint64_t, uint64_t> remove(uint64_t i) {
+    assert(i < size());
+
+    auto res = root->remove(i);
+
+    // shrink the tree: a root with only one internal child is useless
+    while (not root->has_leaves() and root->nr_children() == 1) {
+      node* child = root->release_child(0);
+      delete root;
+      root = child;
+    }
+
+    return res;
+  }
+
+  /*
+   * append n symbols stored in the vector of W-bit packed words (symbol j is
+   * stored in bits [(j%(64/W))*W, (j%(64/W)+1)*W) of word j/(64/W)). Full
+   * leaves are built directly from the words and the tree is rebuilt bottom-up,
+   * so this is linear in the number of appended words.
+   */
+  void append_words(const vector<uint64_t>& words, uint64_t n) {
+    assert(words.size() * SYM_PER_WORD >= n);
+
+    vector<leaf*> lvs;
+    root->collect_leaves(lvs);
+    root->detach();
+    delete root;
+
+    // drop empty leaves (the empty tree has one empty leaf)
+    lvs.erase(std::remove_if(lvs.begin(), lvs.end(),
+                             [](leaf* l) {
+                               if (l->size() > 0) return false;
+                               delete l;
+                               return true;
+                             }),
+              lvs.end());
+
+    uint64_t j = 0;
+    while (j < n) {
+      uint64_t len = std::min<uint64_t>(B_LEAF, n - j);
+
+      // fill the last leaf, if it is not full
+      if (lvs.size() > 0 and lvs.back()->size() < B_LEAF)
+        len = std::min<uint64_t>(len, B_LEAF - lvs.back()->size());
+      else
+        lvs.push_back(new leaf());
+
+      lvs.back()->append(words, j, len);
+      j += len;
+    }
+
+    root = build(lvs);
+  }
+
+  ulint bit_size() const { return sizeof(packed_symbol_vector) * 8 + root->bit_size(); }
+
+  /*
+   * leaves are stored in order: load() rebuilds the internal nodes bottom-up
+   */
+  ulint serialize(ostream& out) const {
+    ulint w_bytes = 0;
+
+    vector<const leaf*> lvs;
+    root->collect_leaves(lvs);
+
+    ulint nr_leaves = lvs.size();
+    out.write((char*)&nr_leaves, sizeof(nr_leaves));
+    w_bytes += sizeof(nr_leaves);
+
+    for (auto l : lvs) w_bytes += l->serialize(out);
+
+    return w_bytes;
+  }
+
+  void load(istream& in) {
+    ulint nr_leaves;
+    in.read((char*)&nr_leaves, sizeof(nr_leaves));
+
+    vector<leaf*> lvs(nr_leaves);
+    for (auto& l : lvs) {
+      l = new leaf();
+      l->load(in);
+    }
+
+    delete root;
+    root = build(lvs);
+  }
+
+ private:
+  static constexpr uint64_t SYM_PER_WORD = 64 / W;
+  static constexpr uint64_t SYM_MASK = SIGMA - 1;
+
+  // 1 in the lowest bit of each W-bit field
+  static constexpr uint64_t LOW_BITS = ~uint64_t(0) / SYM_MASK;
+
+  /*
+   * returns a word with the lowest bit of each W-bit field set iff that
+   * field equals c
+   */
+  static uint64_t match(uint64_t word, uint64_t c) {
+    uint64_t x = word ^ (c * LOW_BITS);
+
+    for (uint8_t s = 1; s < W; s <<= 1) x |= x >> s;
+
+    return ~x & LOW_BITS;
+  }
+
+  /*
+   * mask selecting the first k symbols of a word (k < SYM_PER_WORD)
+   */
+  static uint64_t prefix_mask(uint64_t k) { return (uint64_t(1) << (k * W)) - 1; }
+
+  class leaf {
+   public:
+    uint64_t size() const { return size_; }
+
+    uint64_t at(uint64_t i) const {
+      assert(i < size_);
+      return (words[i / SYM_PER_WORD] >> ((i % SYM_PER_WORD) * W)) & SYM_MASK;
+    }
+
+    uint64_t rank(uint64_t i, uint64_t c) const {
+      assert(i <= size_);
+
+      uint64_t r = 0;
+      uint64_t w = i / SYM_PER_WORD;
+
+      for (uint64_t j = 0; j < w; ++j) r += __builtin_popcountll(match(words[j], c));
+
+      if (i % SYM_PER_WORD)
+        r += __builtin_popcountll(match(words[w], c) & prefix_mask(i % SYM_PER_WORD));
+
+      return r;
+    }
+
+    uint64_t select(uint64_t i, uint64_t c) const {
+      uint64_t nr_words = (size_ + SYM_PER_WORD - 1) / SYM_PER_WORD;
+
+      for (uint64_t j = 0; j < nr_words; ++j) {
+        uint64_t m = match(words[j], c);
+
+        // do not count the padding of the last word
+        if (j == nr_words - 1 and size_ % SYM_PER_WORD)
+          m &= prefix_mask(size_ % SYM_PER_WORD);
+
+        uint64_t pop = __builtin_popcountll(m);
+
+        if (i < pop) {
+          for (uint64_t k = 0; k < i; ++k) m &= m - 1;
+          return j * SYM_PER_WORD + __builtin_ctzll(m) / W;
+        }
+
+        i -= pop;
+      }
+
+      assert(false);
+      return size_;
+    }
+
+    void insert(uint64_t i, uint64_t c) {
+      assert(i <= size_);
+
+      if (size_ % SYM_PER_WORD == 0) words.push_back(0);
+
+      uint64_t w = i / SYM_PER_WORD;
+      uint64_t off = (i % SYM_PER_WORD) * W;
+
+      // shift words after w one symbol to the right
+      for (uint64_t j = words.size() - 1; j > w; --j)
+        words[j] = (words[j] << W) | (words[j - 1] >> (64 - W));
+
+      uint64_t low = words[w] & prefix_mask(i % SYM_PER_WORD);
+      uint64_t high = off == 0 ? words[w] : (words[w] >> off) << off;
+
+      words[w] = low | (high << W) | (c << off);
+
+      ++size_;
+    }
+
+    uint64_t remove(uint64_t i) {
+      assert(i < size_);
+
+      uint64_t c = at(i);
+      uint64_t w = i / SYM_PER_WORD;
+      uint64_t off = (i % SYM_PER_WORD) * W;
+
+      uint64_t low = words[w] & prefix_mask(i % SYM_PER_WORD);
+      uint64_t high = off + W == 64 ? 0 : (words[w] >> (off + W)) << off;
+
+      words[w] = low | high;
+
+      // shift words after w one symbol to the left
+      for (uint64_t j = w + 1; j < words.size(); ++j) {
+        words[j - 1] |= words[j] << (64 - W);
+        words[j] >>= W;
+      }
+
+      --size_;
+
+      if (size_ % SYM_PER_WORD == 0) words.pop_back();
+
+      return c;
+    }
+
+    /*
+     * append symbols [from, from+len) of the packed vector V
+     */
+    void append(const vector<uint64_t>& V, uint64_t from, uint64_t len) {
+      for (uint64_t j = from; j < from + len; ++j) {
+        if (size_ % SYM_PER_WORD == 0) words.push_back(0);
+
+        uint64_t c = (V[j / SYM_PER_WORD] >> ((j % SYM_PER_WORD) * W)) & SYM_MASK;
+        words.back() |= c << ((size_ % SYM_PER_WORD) * W);
+        ++size_;
+      }
+    }
+
+    /*
+     * move the second half of this leaf into a new leaf
+     */
+    leaf* split() {
+      leaf* right = new leaf();
+      uint64_t half = size_ / 2;
+
+      right->append(words, half, size_ - half);
+
+      size_ = half;
+      words.resize((size_ + SYM_PER_WORD - 1) / SYM_PER_WORD);
+      if (size_ % SYM_PER_WORD) words.back() &= prefix_mask(size_ % SYM_PER_WORD);
+
+      return right;
+    }
+
+    /*
+     * append all symbols of other to this leaf
+     */
+    void merge(const leaf* other) { append(other->words, 0, other->size_); }
+
+    ulint bit_size() const { return sizeof(leaf) * 8 + words.capacity() * 64; }
+
+    ulint serialize(ostream& out) const {
+      out.write((char*)&size_, sizeof(size_));
+      out.write((char*)words.data(), words.size() * sizeof(uint64_t));
+      return sizeof(size_) + words.size() * sizeof(uint64_t);
+    }
+
+    void load(istream& in) {
+      in.read((char*)&size_, sizeof(size_));
+      words = vector<uint64_t>((size_ + SYM_PER_WORD - 1) / SYM_PER_WORD);
+      in.read((char*)words.data(), words.size() * sizeof(uint64_t));
+    }
+
+   private:
+    vector<uint64_t> words;
+    uint64_t size_ = 0;
+  };
+
+  class node {
+   public:
+    // empty tree: one empty leaf
+    node() : has_leaves_(true) {
+      leaves.push_back(new leaf());
+      sizes.push_back(0);
+      counts.insert(counts.end(), SIGMA, 0);
+    }
+
+    explicit node(vector<leaf*>&& lvs) : has_leaves_(true), leaves(std::move(lvs)) {
+      for (uint64_t k = 0; k < leaves.size(); ++k) push_stats(k);
+    }
+
+    explicit node(vector<node*>&& ch) : has_leaves_(false), children(std::move(ch)) {
+      for (uint64_t k = 0; k < children.size(); ++k) push_stats(k);
+    }
+
+    node(const node& other)
+        : has_leaves_(other.has_leaves_), sizes(other.sizes), counts(other.counts) {
+      for (auto l : other.leaves) leaves.push_back(new leaf(*l));
+      for (auto c : other.children) children.push_back(new node(*c));
+    }
+
+    ~node() {
+      for (auto l : leaves) delete l;
+      for (auto c : children) delete c;
+    }
+
+    bool has_leaves() const { return has_leaves_; }
+
+    uint64_t nr_children() const { return sizes.size(); }
+
+    uint64_t size() const {
+      uint64_t s = 0;
+      for (auto x : sizes) s += x;
+      return s;
+    }
+
+    uint64_t count(uint64_t c) const {
+      uint64_t s = 0;
+      for (uint64_t k = 0; k < nr_children(); ++k) s += counts[k * SIGMA + c];
+      return s;
+    }
+
+    uint64_t at(uint64_t i) const {
+      uint64_t k = child_at(i);
+      return has_leaves_ ? leaves[k]->at(i) : children[k]->at(i);
+    }
+
+    pair<uint64_t, uint64_t> at_rank(uint64_t i) const {
+      uint64_t k = child_at(i);
+
+      pair<uint64_t, uint64_t> res;
+
+      if (has_leaves_) {
+        res.first = leaves[k]->at(i);
+        res.second = leaves[k]->rank(i, res.first);
+      } else {
+        res = children[k]->at_rank(i);
+      }
+
+      res.second += prefix_count(k, res.first);
+      return res;
+    }
+
+    uint64_t rank(uint64_t i, uint64_t c) const {
+      uint64_t r = 0;
+      uint64_t k = 0;
+
+      while (k + 1 < nr_children() and i > sizes[k]) {
+        i -= sizes[k];
+        r += counts[k * SIGMA + c];
+        ++k;
+      }
+
+      // i falls at the end of child k: answer from the counters
+      if (i == sizes[k]) return r + counts[k * SIGMA + c];
+
+      return r + (has_leaves_ ? leaves[k]->rank(i, c) : children[k]->rank(i, c));
+    }
+
+    uint64_t select(uint64_t i, uint64_t c) const {
+      uint64_t pos = 0;
+      uint64_t k = 0;
+
+      while (i >= counts[k * SIGMA + c]) {
+        i -= counts[k * SIGMA + c];
+        pos += sizes[k];
+        ++k;
+        assert(k < nr_children());
+      }
+
+      return pos + (has_leaves_ ? leaves[k]->select(i, c) : children[k]->select(i, c));
+    }
+
+    /*
+     * insert c at position i; r is set to rank(i,c).
+     * If this node overflows, it is split and the new right sibling returned.
+     */
+    node* insert(uint64_t i, uint64_t c, uint64_t& r) {
+      uint64_t k = child_for_insert(i);
+
+      if (has_leaves_) {
+        r = leaves[k]->rank(i, c);
+        leaves[k]->insert(i, c);
+
+        if (leaves[k]->size() > 2 * B_LEAF) {
+          leaves.insert(leaves.begin() + k + 1, leaves[k]->split());
+          insert_stats(k + 1);
+          reset_stats(k);
+        } else {
+          sizes[k]++;
+          counts[k * SIGMA + c]++;
+        }
+
+      } else {
+        node* sibling = children[k]->insert(i, c, r);
+
+        if (sibling) {
+          children.insert(children.begin() + k + 1, sibling);
+          insert_stats(k + 1);
+          reset_stats(k);
+        } else {
+          sizes[k]++;
+          counts[k * SIGMA + c]++;
+        }
+      }
+
+      r += prefix_count(k, c);
+
+      return nr_children() > 2 * B ? split() : nullptr;
+    }
+
+    /*
+     * remove the symbol at position i. Underflowing children are merged
+     * with a neighbour when the result fits in one node.
+     */
+    pair<uint64_t, uint64_t> remove(uint64_t i) {
+      uint64_t k = child_at(i);
+
+      pair<uint64_t, uint64_t> res;
+
+      if (has_leaves_) {
+        res.second = leaves[k]->rank(i, leaves[k]->at(i));
+        res.first = leaves[k]->remove(i);
+      } else {
+        res = children[k]->remove(i);
+      }
+
+      sizes[k]--;
+      counts[k * SIGMA + res.first]--;
+
+      res.second += prefix_count(k, res.first);
+
+      rebalance(k);
+
+      return res;
+    }
+
+    template <class leaf_ptr>
+    void collect_leaves(vector<leaf_ptr>& lvs) const {
+      if (has_leaves_) {
+        lvs.insert(lvs.end(), leaves.begin(), leaves.end());
+      } else {
+        for (auto c : children) c->collect_leaves(lvs);
+      }
+    }
+
+    /*
+     * forget (without freeing) all leaves of this subtree
+     */
+    void detach() {
+      leaves.clear();
+      for (auto c : children) c->detach();
+    }
+
+    node* release_child(uint64_t k) {
+      assert(not has_leaves_);
+      node* c = children[k];
+      children.erase(children.begin() + k);
+      sizes.erase(sizes.begin() + k);
+      counts.erase(counts.begin() + k * SIGMA, counts.begin() + (k + 1) * SIGMA);
+      return c;
+    }
+
+    ulint bit_size() const {
+      ulint size = sizeof(node) * 8;
+      size += (sizes.capacity() + counts.capacity()) * 64;
+      size += (leaves.capacity() + children.capacity()) * sizeof(void*) * 8;
+      for (auto l : leaves) size += l->bit_size();
+      for (auto c : children) size += c->bit_size();
+      return size;
+    }
+
+   private:
+    uint64_t child_size(uint64_t k) const {
+      return has_leaves_ ? leaves[k]->size() : children[k]->nr_children();
+    }
+
+    // find child containing position i (i is made relative to that child)
+    uint64_t child_at(uint64_t& i) const {
+      uint64_t k = 0;
+      while (i >= sizes[k]) {
+        i -= sizes[k];
+        ++k;
+        assert(k < nr_children());
+      }
+      return k;
+    }
+
+    // as child_at, but i can be equal to the size of the last child
+    uint64_t child_for_insert(uint64_t& i) const {
+      uint64_t k = 0;
+      while (k + 1 < nr_children() and i > sizes[k]) {
+        i -= sizes[k];
+        ++k;
+      }
+      return k;
+    }
+
+    uint64_t prefix_count(uint64_t k, uint64_t c) const {
+      uint64_t r = 0;
+      for (uint64_t j = 0; j < k; ++j) r += counts[j * SIGMA + c];
+      return r;
+    }
+
+    // compute size and counters of the child k, appending them
+    void push_stats(uint64_t k) {
+      assert(k == sizes.size());
+      sizes.push_back(0);
+      counts.insert(counts.end(), SIGMA, 0);
+      reset_stats(k);
+    }
+
+    void insert_stats(uint64_t k) {
+      sizes.insert(sizes.begin() + k, 0);
+      counts.insert(counts.begin() + k * SIGMA, SIGMA, 0);
+      reset_stats(k);
+    }
+
+    // recompute size and counters of the child k from scratch
+    void reset_stats(uint64_t k) {
+      if (has_leaves_) {
+        sizes[k] = leaves[k]->size();
+        for (uint64_t c = 0; c < SIGMA; ++c) counts[k * SIGMA + c] = leaves[k]->rank(sizes[k], c);
+      } else {
+        sizes[k] = children[k]->size();
+        for (uint64_t c = 0; c < SIGMA; ++c) counts[k * SIGMA + c] = children[k]->count(c);
+      }
+    }
+
+    node* split() {
+      uint64_t half = nr_children() / 2;
+
+      node* right;
+
+      if (has_leaves_) {
+        right = new node(vector<leaf*>(leaves.begin() + half, leaves.end()));
+        leaves.resize(half);
+      } else {
+        right = new node(vector<node*>(children.begin() + half, children.end()));
+        children.resize(half);
+      }
+
+      sizes.resize(half);
+      counts.resize(half * SIGMA);
+
+      return right;
+    }
+
+    /*
+     * if child k is too small, merge it with a neighbour (when the merged
+     * child does not overflow) or remove it (when empty)
+     */
+    void rebalance(uint64_t k) {
+      uint64_t min_size = has_leaves_ ? B_LEAF / 2 : B / 2;
+      uint64_t max_size = has_leaves_ ? 2 * B_LEAF : 2 * B;
+
+      if (nr_children() == 1 or child_size(k) >= min_size) return;
+
+      // merge children l and l+1
+      uint64_t l = k + 1 < nr_children() ? k : k - 1;
+
+      if (child_size(l) + child_size(l + 1) > max_size) return;
+
+      if (has_leaves_) {
+        leaves[l]->merge(leaves[l + 1]);
+        delete leaves[l + 1];
+        leaves.erase(leaves.begin() + l + 1);
+      } else {
+        children[l]->absorb(children[l + 1]);
+        delete children[l + 1];
+        children.erase(children.begin() + l + 1);
+      }
+
+      sizes[l] += sizes[l + 1];
+      for (uint64_t c = 0; c < SIGMA; ++c) counts[l * SIGMA + c] += counts[(l + 1) * SIGMA + c];
+
+      sizes.erase(sizes.begin() + l + 1);
+      counts.erase(counts.begin() + (l + 1) * SIGMA, counts.begin() + (l + 2) * SIGMA);
+    }
+
+    // move all children of other (a node at the same level) into this node
+    void absorb(node* other) {
+      assert(has_leaves_ == other->has_leaves_);
+
+      leaves.insert(leaves.end(), other->leaves.begin(), other->leaves.end());
+      children.insert(children.end(), other->children.begin(), other->children.end());
+      sizes.insert(sizes.end(), other->sizes.begin(), other->sizes.end());
+      counts.insert(counts.end(), other->counts.begin(), other->counts.end());
+
+      other->leaves.clear();
+      other->children.clear();
+    }
+
+    bool has_leaves_;
+
+    vector<leaf*> leaves;
+    vector<node*> children;
+
+    // per child: number of symbols and number of occurrences of each symbol
+    vector<uint64_t> sizes;
+    vector<uint64_t> counts;
+  };
+
+  /*
+   * build the tree bottom-up from a sequence of leaves
+   */
+  static node* build(vector<leaf*>& lvs) {
+    if (lvs.size() == 0) return new node();
+
+    vector<node*> level;
+
+    for (uint64_t j = 0; j < lvs.size(); j += B)
+      level.push_back(new node(vector<leaf*>(lvs.begin() + j,
+                                             lvs.begin() + std::min<uint64_t>(j + B, lvs.size()))));
+
+    while (level.size() > 1) {
+      vector<node*> next;
+
+      for (uint64_t j = 0; j < level.size(); j += B)
+        next.push_back(new node(vector<node*>(level.begin() + j,
+                                              level.begin() + std::min<uint64_t>(j + B, level.size()))));
+
+      level = std::move(next);
+    }
+
+    return level[0];
+  }
+
+  void new_root(node* sibling) {
+    vector<node*> ch{root, sibling};
+    root = new node(std::move(ch));
+  }
+
+  node* root = nullptr;
+};
+
+}  // namespace dyn
+
+#endif /* INTERNAL_PACKED_SYMBOL_VECTOR_HPP_ */
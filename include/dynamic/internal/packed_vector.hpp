@@ -533,23 +533,19 @@ namespace dyn{
             // only one integer to insert
             insert(i, word);
 
-        } else if (width == 1 && width_ == 1 && n == 64) {
-            // insert 64 bits packed into a word
+        } else if (width == 1 && width_ == 1 && n == 64 && i == size_) {
+            // append 64 bits packed into a word (words after
+            // position size_ are all zero)
             uint64_t pos = size_ / 64;
             uint8_t offset = size_ - pos * 64;
 
             if (!offset) {
                 words.insert(words.begin() + pos, word);
             } else {
-                assert(pos + 1 < words.size());
+                assert(pos < words.size());
 
-                words.insert(words.begin() + pos, words[pos + 1]);
-
-                words[pos] &= ((1llu << offset) - 1);
                 words[pos] |= word << offset;
-
-                words[pos + 1] &= ~((1llu << offset) - 1);
-                words[pos + 1] &= word >> (64 - offset);
+                words.insert(words.begin() + pos + 1, word >> (64 - offset));
             }
 
             size_ += n;
@@ -754,8 +750,9 @@ namespace dyn{
 
 	 in.read((char*)&int_per_word_,sizeof(int_per_word_));
 
-	 assert(size_ / int_per_word_ + (size_%int_per_word_!=0) <= words.size());
-	 assert((size_ / int_per_word_ + (size_%int_per_word_!=0) == words.size()
+	 //empty vectors have width 0
+	 assert(width_ == 0 or size_ / int_per_word_ + (size_%int_per_word_!=0) <= words.size());
+	 assert((width_ == 0 or size_ / int_per_word_ + (size_%int_per_word_!=0) == words.size()
                 || !(words[words.size()-1] >> ((size_ % int_per_word_) * width_)))
             && "uninitialized non-zero values in the end of the vector");
       }
@@ -993,10 +990,7 @@ namespace dyn{
 	    int_per_word_ = 0;
 	    psum_ = 0;
 
-		 assert(size_ / int_per_word_ + (size_%int_per_word_!=0) <= words.size());
-		 assert((size_ / int_per_word_ + (size_%int_per_word_!=0) == words.size()
-                   || !(words[words.size()-1] >> ((size_ % int_per_word_) * width_)))
-               && "uninitialized non-zero values in the end of the vector");
+	    //the vector is empty: int_per_word_ is 0 until the next insertion
 	    return;
 	 }
 	 
@@ -1185,6 +1179,9 @@ public:
     packed_bit_vector(vector<uint64_t>&& words, uint64_t size)
         : packed_vector(std::move(words), size, 1) {}
 
+    packed_bit_vector(vector<uint64_t>&& words, uint64_t size, uint8_t width)
+        : packed_vector(std::move(words), size, 1) { assert(width == 1); }
+
     virtual void push_back(uint64_t x) override final {
         assert(int_per_word_ == 64);
         assert(size_ <= words.size() * 64);
@@ -0,0 +1,452 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * r_index.hpp
+ *
+ *  Dynamic r-index: FM index whose suffix array samples are taken at the
+ *  BWT run boundaries. Supports LF mapping, backward search, locate, left-extend text.
+ *
+ *  Space is O(r) words on top of the BWT, where r is the number of BWT runs
+ *  (against n/k words of the classic sampling of fm_index.hpp).
+ *
+ *  For each BWT row j that starts a run (j=0 included), we store SA[j]
+ *  (indexed by row) and phi(SA[j]) = SA[j-1] (indexed by text position, with
+ *  phi(SA[0]) = SA[n-1]). Then:
+ *
+ *  - toehold lemma: backward search keeps SA at the last row of the current
+ *    range. If the row does not end with the next character c, the last c
+ *    in the range ends a run and its SA value is the phi value of the next
+ *    run head.
+ *  - phi function: SA[i-1] = phi(SA[i]) = phi(q) - (q - SA[i]), where q >= SA[i]
+ *    is the smallest sampled text position (a successor query): if the row
+ *    of p is not the head of a run, LF maps the rows of p and phi(p) to
+ *    consecutive rows, so phi(p+1) = phi(p)+1.
+ *
+ *  Hence, locate costs O(log n) per occurrence after the first.
+ *
+ *  Since text positions are enumerated from the end (the BWT terminator has
+ *  position 0), each extend appends a new text position and leaves the other
+ *  SA values unchanged: only O(1) samples around the old and new terminator
+ *  positions need to be updated.
+ *
+ *  Note: alphabet character 2^64-1 is reserved for the BWT terminator
+ *
+ */
+
+#ifndef INCLUDE_INTERNAL_R_INDEX_HPP_
+#define INCLUDE_INTERNAL_R_INDEX_HPP_
+
+#include "dynamic/internal/includes.hpp"
+
+namespace dyn{
+
+template <	class dyn_bwt,	//dynamic BWT (should be run-length encoded)
+			class dyn_bv,	//dynamic bitvector (should be gap-encoded)
+			class dyn_vec	//dynamic vector
+		>
+class r_index : public dyn_bwt{
+
+public:
+
+	//we allow any alphabet
+	using char_type = ulint;
+
+	/*
+	 * Constructor #1
+	 *
+	 * Alphabet is unknown. Characters are gamma-coded.
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	r_index(){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #2
+	 *
+	 * We know only alphabet size. Each character is assigned log2(sigma) bits.
+	 * Characters are assigned codes 0,1,2,... in order of appearance
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	r_index(uint64_t sigma) : dyn_bwt(sigma){
+
+		init();
+
+	}
+
+	/*
+	 * Constructor #3
+	 *
+	 * We know character probabilities. Input: pairs <character, probability>
+	 *
+	 * Here the alphabet is Huffman encoded.
+	 * BWT is initialized with only terminator character (size=1)
+	 *
+	 */
+	r_index(vector<pair<char_type,double> >& P) : dyn_bwt(P){
+
+		init();
+
+	}
+
+	/*
+	 * input: position on F column of the BWT
+	 * output: corresponding position on text. Note that
+	 * text positions are enumerated from the end, with
+	 * the BWT terminator (last character) having position 0.
+	 *
+	 * There is no toehold here: we follow FL until a run boundary is met
+	 * (O(n/r) steps on average). Prefer locate(P).
+	 */
+	ulint locate(ulint i) const {
+
+		ulint j = 0;
+
+		while(not heads.at(i) and (i+1 == this->bwt_length() or not heads.at(i+1))){
+
+			i = this->FL(i);
+			j++;
+
+		}
+
+		return (heads.at(i) ? head_SA(i) : tail_SA(i)) + j;
+
+	}
+
+	/*
+	 * input: range [l,r) (right-excluded) of positions on F column of the BWT
+	 * output: vector of corresponding positions on text. Note that
+	 * text positions are enumerated from the end, with
+	 * the BWT terminator (last character) having position 0.
+	 */
+	vector<ulint> locate(pair<ulint,ulint> range) const {
+
+		if(range.second <= range.first) return {};
+
+		return locate(range, locate(range.second-1));
+
+	}
+
+	/*
+	 * input: range [l,r) (right-excluded) of positions on F column of the BWT
+	 * and toehold = SA[r-1]
+	 * output: vector of corresponding positions on text, obtained with phi.
+	 * Positions are listed in BWT order.
+	 */
+	vector<ulint> locate(pair<ulint,ulint> range, ulint toehold) const {
+
+		auto res = vector<ulint>(range.second > range.first ? range.second - range.first : 0);
+
+		ulint p = toehold;
+
+		for(ulint k=res.size();k>0;--k){
+
+			res[k-1] = p;
+			if(k>1) p = phi(p);
+
+		}
+
+		return res;
+
+	}
+
+	/*
+	 * input: pattern P
+	 * output: occurrences of P in the text
+	 */
+	vector<ulint> locate(vector<char_type> P) const {
+
+		auto rt = count_toehold(P);
+
+		return locate(rt.first, rt.second);
+
+	}
+
+	/*
+	 * backward search keeping the toehold.
+	 * input: pattern P
+	 * output: range [l,r) (right-exclusive) on BWT of P and SA[r-1]
+	 * (undefined if the range is empty)
+	 */
+	pair<pair<ulint,ulint>,ulint> count_toehold(vector<char_type> P) const {
+
+		pair<ulint,ulint> rn = {0,this->size()};
+
+		//SA of last row
+		ulint t = phi_.at(0);
+
+		for(ulint i=0;i<P.size() and rn.second > rn.first;++i){
+
+			char_type c = P.at(P.size()-i-1);
+			ulint last = rn.second-1;
+
+			rn = this->LF(rn, c);
+
+			if(rn.second <= rn.first) break;
+
+			//if the range does not end with c, then the last c in the
+			//range ends a BWT run
+			t = this->at(last) == c ? t+1 : tail_SA(this->FL(rn.second-1)) + 1;
+
+		}
+
+		return {rn,t};
+
+	}
+
+	/*
+	 * build r-index of cW from r-index of W
+	 */
+	void extend(char_type c){
+
+		ulint N = this->bwt_length();			//rows before the extension
+		ulint t = this->get_terminator_position();	//row of W
+		ulint pos_W = this->text_length();		//text position of W
+
+		/*
+		 * SA values of the rows that will surround the new row. These are
+		 * computed on the old BWT: FL(row) is the end of a run (resp. the
+		 * head of a run) for the row preceding (resp. following) the new one
+		 */
+		pair<ulint,ulint> rc = this->LF({0,N},c);
+
+		//new row, in the old coordinates
+		ulint new_row = rc.second > rc.first ? this->LF(t,c) : first_row(c);
+
+		ulint prev_SA = new_row == 1 ? 0 : tail_SA(this->FL(new_row-1)) + 1;
+		ulint next_SA = new_row < N ? head_SA(this->FL(new_row)) + 1 : 0;
+
+		//phi(SA[t]) = SA[t-1], since t was the head of a run
+		ulint phi_W = phi_at(pos_W);
+
+		dyn_bwt::extend(c);	//extend BWT
+
+		ulint tp = this->get_terminator_position();
+		assert(tp == new_row);
+
+		//row of W in the new BWT
+		ulint u = t < tp ? t : t+1;
+
+		//the new row (which contains the terminator) is the head of a run
+		heads.insert(tp,true);
+		SA.insert(heads.rank1(tp),this->text_length());
+
+		sampled.push_back(true);
+		phi_.insert(phi_.size(),prev_SA);
+
+		//phi of the first row wraps around
+		if(tp == N) phi_.set(0,this->text_length());
+
+		/*
+		 * update runs around the old terminator (now c) and after the new one.
+		 * Row tp+1 follows the terminator, hence it is always the head of a run
+		 */
+		if(u > 0 and u != tp)
+			update_head(u, u-1 == tp or this->at(u-1) != c, pos_W, u-1 == tp ? this->text_length() : phi_W);
+
+		if(u+1 < N+1 and u+1 != tp)
+			update_head(u+1, this->at(u+1) != c, head_SA(u+1), pos_W);
+
+		if(tp+1 < N+1 and tp+1 != u)
+			update_head(tp+1, true, next_SA, this->text_length());
+
+	}
+
+	/*
+	 * number of SA samples (equal to the number of BWT runs)
+	 */
+	ulint number_of_samples() const {
+
+		return SA.size();
+
+	}
+
+	/*
+	 * Total number of bits allocated in RAM for this structure
+	 *
+	 * WARNING: this measure is good only for relatively small alphabets (e.g. ASCII)
+	 * as we use STL containers such as set and map which do not give direct info on
+	 * the total memory allocated. The sizes of these containers are proportional
+	 * to the alphabet size (but the constants involved are high since internally
+	 * they can use heavy structures as RBT)
+	 */
+	ulint bit_size() const {
+
+		ulint size = sizeof(r_index<dyn_bwt,dyn_bv,dyn_vec>)*8;
+
+		size += dyn_bwt::bit_size();
+		size += heads.bit_size();
+		size += SA.bit_size();
+		size += sampled.bit_size();
+		size += phi_.bit_size();
+
+		return size;
+
+	}
+
+	ulint serialize(ostream &out) const {
+
+		ulint w_bytes=0;
+
+		w_bytes += dyn_bwt::serialize(out);
+
+		w_bytes += heads.serialize(out);
+		w_bytes += SA.serialize(out);
+		w_bytes += sampled.serialize(out);
+		w_bytes += phi_.serialize(out);
+
+		return w_bytes;
+
+	}
+
+	void load(istream &in){
+
+		dyn_bwt::load(in);
+
+		heads.load(in);
+		SA.load(in);
+		sampled.load(in);
+		phi_.load(in);
+
+	}
+
+private:
+
+	//merging is not supported: the run samples would not be built
+	using dyn_bwt::merge;
+
+	/*
+	 * BWT with only the terminator: row 0 is the head of the only run
+	 */
+	void init(){
+
+		heads.insert(0,true);
+		SA.insert(0,0);
+
+		sampled.insert(0,true);
+		phi_.insert(0,0);
+
+	}
+
+	/*
+	 * first row of the F-block of a character c not in the text
+	 */
+	ulint first_row(char_type c) const {
+
+		auto A = this->get_alphabet();
+
+		//first character larger than c (the terminator is the largest integer)
+		auto it = A.upper_bound(c);
+
+		return *it == this->get_terminator() ? this->bwt_length() : this->LF(0,*it);
+
+	}
+
+	/*
+	 * SA value of row i, which must be the head of a run
+	 */
+	ulint head_SA(ulint i) const {
+
+		assert(heads.at(i));
+		return SA.at(heads.rank1(i));
+
+	}
+
+	/*
+	 * SA value of row i, which must be the last row of a run
+	 */
+	ulint tail_SA(ulint i) const {
+
+		ulint j = i+1 == this->bwt_length() ? 0 : i+1;
+		return phi_at(head_SA(j));
+
+	}
+
+	/*
+	 * phi value of text position p, which must be sampled
+	 */
+	ulint phi_at(ulint p) const {
+
+		assert(sampled.at(p));
+		return phi_.at(sampled.rank1(p));
+
+	}
+
+	/*
+	 * SA[i-1], given p = SA[i] (i>0)
+	 */
+	ulint phi(ulint p) const {
+
+		//smallest sampled position q >= p (the text position of the
+		//terminator is always sampled)
+		ulint k = sampled.rank1(p);
+		ulint q = sampled.select1(k);
+
+		return phi_.at(k) - (q - p);
+
+	}
+
+	/*
+	 * row i (i>0) has SA[i] = sa and SA[i-1] = sa_prev. Mark/unmark
+	 * i as head of a run, and update phi
+	 */
+	void update_head(ulint i, bool head, ulint sa, ulint sa_prev){
+
+		assert(i>0);
+		assert(head == (this->at(i) != this->at(i-1)));
+
+		if(heads.at(i)){
+
+			if(head){
+
+				phi_.set(sampled.rank1(sa),sa_prev);
+
+			}else{
+
+				SA.remove(heads.rank1(i));
+				heads.remove(i);
+				heads.insert(i,false);
+
+				phi_.remove(sampled.rank1(sa));
+				sampled.remove(sa);
+				sampled.insert(sa,false);
+
+			}
+
+		}else if(head){
+
+			heads.remove(i);
+			heads.insert(i,true);
+			SA.insert(heads.rank1(i),sa);
+
+			sampled.remove(sa);
+			sampled.insert(sa,true);
+			phi_.insert(sampled.rank1(sa),sa_prev);
+
+		}
+
+	}
+
+	//marks BWT rows that are heads of runs (row-indexed)
+	dyn_bv heads;
+
+	//SA values of run heads, in BWT order
+	dyn_vec SA;
+
+	//marks text positions that are SA values of run heads (text-indexed)
+	dyn_bv sampled;
+
+	//phi values of sampled positions, in text order
+	dyn_vec phi_;
+
+};
+
+}
+
+#endif /* INCLUDE_INTERNAL_R_INDEX_HPP_ */
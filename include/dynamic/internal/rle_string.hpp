@@ -10,12 +10,19 @@
  *
  *  in the bitvectors, runs are encoded as 0^k1, k being the run length
  *
+ *  Positions can be marked (see mark()): a marked position is kept at the
+ *  head of its run, splitting the run if needed, so that it follows the
+ *  insertions for free. Runs are then no longer maximal: two adjacent runs
+ *  can have the same head.
+ *
  */
 
 #ifndef INCLUDE_INTERNAL_RLE_STRING_HPP_
 #define INCLUDE_INTERNAL_RLE_STRING_HPP_
 
 #include "dynamic/internal/includes.hpp"
+#include "dynamic/internal/spsi.hpp"
+#include "dynamic/internal/packed_vector.hpp"
 
 namespace dyn{
 
@@ -69,6 +76,15 @@ public:
 
 	}
 
+	/*
+	 * enable adaptive re-encoding of the run heads (see wt_string)
+	 */
+	void set_reencoding_threshold(double gap){
+
+		run_heads_.set_reencoding_threshold(gap);
+
+	}
+
 	char_type at(ulint i) const {
 
 		assert(i<runs.size());
@@ -111,6 +127,53 @@ public:
 
 	}
 
+	/*
+	 * positions of the i-th characters c, for all i in I (sorted
+	 * in increasing order). Ranks falling in the same c-run share
+	 * the select on the run heads.
+	 */
+	vector<ulint> select(const vector<ulint>& I, char_type c) const {
+
+		vector<ulint> res(I.size());
+
+		if(I.empty()) return res;
+
+		assert(run_heads_.char_exists(c));
+		assert(I.back() < rank(size(),c));
+
+		const auto& rpl = runs_per_letter.at(c);
+
+		//ranks [first_rank, last_rank] of the current c-run start at position first_pos
+		ulint first_rank = 1, last_rank = 0, first_pos = 0;
+
+		for(ulint k=0;k<I.size();++k){
+
+			ulint i = I[k];
+
+			assert(k==0 or I[k-1] <= i);
+
+			if(i < first_rank or i > last_rank){
+
+				ulint this_c_run = rpl.rank1(i);
+
+				first_rank = this_c_run == 0 ? 0 : rpl.select1(this_c_run-1)+1;
+				last_rank = rpl.select1(this_c_run);
+
+				//run number among all runs
+				ulint this_run = run_heads_.select(this_c_run, c);
+
+				first_pos = this_run == 0 ? 0 : runs.select1(this_run-1)+1;
+
+			}
+
+			res[k] = first_pos + (i - first_rank);
+
+		}
+
+		return res;
+
+	}
+
 	/*
 	 * position of i-th bit not set. 0 =< i < rank(size(),0)
 	 */
@@ -157,7 +220,6 @@ public:
 					0 :
 					i - (this_run == 0 ? 0 : runs.select1(this_run-1)+1 );
 
-		assert(runs_per_letter.at(c).size()>0);
 		assert(this_c_run == 0 || this_c_run-1 < runs_per_letter.at(c).rank1(runs_per_letter.at(c).size()));
 
 		//add also number of cs before this run (excluded)
@@ -167,6 +229,25 @@ public:
 
 	}
 
+	/*
+	 * distinct characters in positions [l,r), with their number of
+	 * occurrences in [l,r), in no particular order. Distinct characters
+	 * are found on the run heads of the runs intersecting [l,r)
+	 */
+	vector<pair<char_type,ulint> > range_distinct(ulint l, ulint r) const {
+
+		assert(l<=r and r<=size());
+
+		if(r<=l) return {};
+
+		auto heads = run_heads_.range_distinct(runs.rank1(l), runs.rank1(r-1)+1);
+
+		for(auto& h : heads) h.second = rank(r,h.first) - rank(l,h.first);
+
+		return heads;
+
+	}
+
 	/*
 	 * number of 0s before position i (only for bitvectors!)
 	 */
@@ -237,9 +318,13 @@ public:
 		//character in position i equals c?
 		bool next_equals_c = (i == size() ? false : next == c);
 
+		//a c inserted just before a marked run head must not join that run:
+		//the head would no longer be the marked character
+		bool before_mark = next_equals_c and not prev_equals_c and marks.size()>0 and marks[runs.rank1(i)];
+
 		//CASE #2: c touches a c-run
 
-		if(prev_equals_c or next_equals_c){
+		if((prev_equals_c or next_equals_c) and not before_mark){
 
 			//since position i touches a c-run, this vector can not be empty
 			assert(runs_per_letter[c].size() > 0);
@@ -248,11 +333,12 @@ public:
 			ulint extended_run = ( prev_equals_c ? runs.rank1(i-1) : runs.rank1(i) );
 
 			//extend run: insert k zeros in runs
-			//if at(i-1) == c and at(i) != c, then insert 0s at position i-1
-			//because position i-1 contains a 1
+			//if at(i-1) == c, then insert 0s at position i-1: if at(i) != c
+			//position i-1 contains a 1, if at(i) == c either i-1 is inside
+			//the run or i is a marked head that must stay after the new cs
 
 			assert( not (prev_equals_c and not next_equals_c) || runs[i-1] );
-			runs.insert0( prev_equals_c and not next_equals_c ? i-1 : i, k );
+			runs.insert0( prev_equals_c ? i-1 : i, k );
 
 			//here c must be present inside run_heads_ since
 			//the new c touches a c-run
@@ -279,8 +365,8 @@ public:
 		//CASE #3.1: insertion at the beginning
 		if(i==0){
 
-			//next character exists and is different than c
-			assert(next != c);
+			//next character exists and is different than c (or is a marked head)
+			assert(next != c or before_mark);
 
 			runs.insert1(0);
 			runs.insert0(0,k-1);
@@ -289,6 +375,8 @@ public:
 			runs_per_letter[c].insert1(0);
 			runs_per_letter[c].insert0(0,k-1);
 
+			if(marks.size()>0) marks.insert0(0);
+
 			//n++;
 			//R++;
 
@@ -315,6 +403,8 @@ public:
 			runs_per_letter[c].insert0(runs_per_letter[c].size(), k-1);
 			runs_per_letter[c].insert1(runs_per_letter[c].size());
 
+			if(marks.size()>0) marks.insert0(marks.size());
+
 			//n++;
 			//R++;
 
@@ -326,9 +416,10 @@ public:
 		}
 
 		//CASE #3.3: c falls between 2 runs of 2 characters different than c
+		//(or before a marked head)
 		//example: aaaaaaaabbbbb -> aaaaaaaacbbbbb
 
-		if(prev != next){
+		if(prev != next or runs[i-1]){
 
 			assert(i>0);
 			assert(i<size());
@@ -344,7 +435,7 @@ public:
 
 			run_heads_.insert(rk,c);
 
-			assert(run_heads_[rk-1]!=c and run_heads_[rk+1]!=c);
+			assert(run_heads_[rk-1]!=c and (run_heads_[rk+1]!=c or before_mark));
 
 			ulint this_c_run = run_heads_.rank(rk,c);
 
@@ -353,6 +444,8 @@ public:
 			runs_per_letter[c].insert1( ins_pos );
 			runs_per_letter[c].insert0( ins_pos, k-1 );
 
+			if(marks.size()>0) marks.insert0(rk);
+
 			//n++;
 			//R++;
 
@@ -404,6 +497,9 @@ public:
 		runs_per_letter[prev].set(a_rank-1);
 		//runs_per_letter[prev].insert1(a_rank);
 
+		//the c-run and the second half of the a-run are not marked
+		if(marks.size()>0) marks.insert0(this_run+1,2);
+
 		//n++;
 		//R += 2;
 
@@ -424,6 +520,156 @@ public:
 
 	}
 
+	/*
+	 * remove the character in position i. If i is marked, its mark is removed
+	 */
+	void remove(ulint i){
+
+		assert(i<size());
+
+		ulint this_run = runs.rank1(i);
+		char_type c = run_heads_[this_run];
+
+		//first and last position of the run
+		ulint l = this_run == 0 ? 0 : runs.select1(this_run-1)+1;
+		ulint r = runs.select1(this_run);
+
+		//the run is the number 'this_c_run' among all c-runs
+		ulint this_c_run = run_heads_.rank(this_run,c);
+		ulint c_l = this_c_run == 0 ? 0 : runs_per_letter[c].select1(this_c_run-1)+1;
+
+		if(i == l and marks.size()>0 and marks[this_run]) unmark_run(this_run);
+
+		if(l < r){
+
+			//the run survives: remove one of its 0s
+			runs.delete0(l);
+			runs_per_letter[c].delete0(c_l);
+
+			//the new head is not marked: the run may join the previous one
+			if(i == l and this_run > 0 and run_heads_[this_run-1] == c) merge_runs(this_run-1);
+
+			return;
+
+		}
+
+		//run of length 1: remove it
+		runs.remove(i);
+		run_heads_.remove(this_run);
+		runs_per_letter[c].remove(c_l);
+
+		if(marks.size()>0) marks.remove(this_run);
+
+		//the runs before and after the removed one are now adjacent
+		if(	this_run > 0 and this_run < number_of_runs() and
+			run_heads_[this_run-1] == run_heads_[this_run] and
+			not (marks.size()>0 and marks[this_run])) merge_runs(this_run-1);
+
+	}
+
+	/*
+	 * mark position i with value x (if i is already marked, its value
+	 * becomes x). The character in position i becomes the head of its run
+	 * (the run is split if i falls inside it) and stays the head until it
+	 * is removed: insertions never extend a marked run on its left. Hence
+	 * marks move with the insertions at no cost; only the creation of new
+	 * runs updates the marks (one bit per run).
+	 */
+	void mark(ulint i, ulint x = 0){
+
+		assert(i<size());
+
+		//first mark: one bit per run
+		if(marks.size()==0) marks.insert0(0,number_of_runs());
+
+		ulint this_run = runs.rank1(i);
+
+		if(i==0 or runs[i-1]){
+
+			if(marks[this_run]){
+
+				mark_values.set(marks.rank1(this_run),x);
+				return;
+
+			}
+
+			marks.set(this_run);
+			mark_values.insert(marks.rank1(this_run),x);
+
+			return;
+
+		}
+
+		//split run: aaaaaa -> aa|aaaa
+		char_type a = run_heads_[this_run];
+
+		ulint a_rank = rank(i,a);
+
+		runs.set(i-1);
+		run_heads_.insert(this_run+1,a);
+		runs_per_letter[a].set(a_rank-1);
+
+		marks.insert1(this_run+1);
+		mark_values.insert(marks.rank1(this_run+1),x);
+
+		assert(marked(i));
+
+	}
+
+	/*
+	 * is position i marked?
+	 */
+	bool marked(ulint i) const {
+
+		assert(i<size());
+
+		return marks.size()>0 and (i==0 or runs[i-1]) and marks[runs.rank1(i)];
+
+	}
+
+	/*
+	 * value of the marked position i
+	 */
+	ulint mark_value(ulint i) const {
+
+		assert(marked(i));
+
+		return mark_values.at(marks.rank1(runs.rank1(i)));
+
+	}
+
+	/*
+	 * number of marked positions
+	 */
+	ulint number_of_marks() const {
+
+		return mark_values.size();
+
+	}
+
+	/*
+	 * first marked position >= i (size() if there is none)
+	 */
+	ulint next_mark(ulint i) const {
+
+		assert(i<=size());
+
+		if(i==size() or number_of_marks()==0) return size();
+
+		//first run whose head is >= i
+		ulint r = runs.rank1(i);
+		if(i>0 and not runs[i-1]) r++;
+
+		ulint k = marks.rank1(r);
+
+		if(k == number_of_marks()) return size();
+
+		ulint m = marks.select1(k);
+
+		return m == 0 ? 0 : runs.select1(m-1)+1;
+
+	}
+
 	//break range: given a range <l',r'> on the string and a character c, this function
 	//breaks <l',r'> in maximal sub-ranges containing character c.
 	//for simplicity and efficiency, we assume that characters at range extremities are both 'c'
@@ -560,6 +806,8 @@ public:
 		size += runs.bit_size();
 
 		size += run_heads_.bit_size();
+		size += marks.bit_size();
+		size += mark_values.bit_size();
 
 		for(auto e : runs_per_letter){
 
@@ -578,6 +826,8 @@ public:
 
 		w_bytes += runs.serialize(out);
 		w_bytes += run_heads_.serialize(out);
+		w_bytes += marks.serialize(out);
+		w_bytes += mark_values.serialize(out);
 
 		ulint rpl_size = runs_per_letter.size();
 
@@ -601,6 +851,8 @@ public:
 
 		runs.load(in);
 		run_heads_.load(in);
+		marks.load(in);
+		mark_values.load(in);
 
 		ulint rpl_size;
 
@@ -619,6 +871,46 @@ public:
 
 private:
 
+	/*
+	 * merge run k with run k+1 (same head, run k+1 not marked)
+	 */
+	void merge_runs(ulint k){
+
+		assert(k+1 < number_of_runs());
+		assert(run_heads_[k] == run_heads_[k+1]);
+		assert(not (marks.size()>0 and marks[k+1]));
+
+		char_type c = run_heads_[k];
+
+		//turn the 1 closing run k into a 0
+		ulint e = runs.select1(k);
+		runs.remove(e);
+		runs.insert0(e);
+
+		//same for the c-run
+		ulint e_c = runs_per_letter[c].select1(run_heads_.rank(k,c));
+		runs_per_letter[c].remove(e_c);
+		runs_per_letter[c].insert0(e_c);
+
+		run_heads_.remove(k+1);
+
+		if(marks.size()>0) marks.remove(k+1);
+
+	}
+
+	/*
+	 * remove the mark of run k
+	 */
+	void unmark_run(ulint k){
+
+		assert(marks[k]);
+
+		mark_values.remove(marks.rank1(k));
+
+		marks.remove(k);
+		marks.insert0(k);
+
+	}
 
 	/*
 	 * split i-th run head: a -> aca
@@ -646,6 +938,12 @@ private:
 	//store run heads in a compressed string supporting access/rank/select/insert
 	string_t run_heads_;
 
+	//one bit per run (empty if there are no marks): the run head is marked
+	sparse_bitvector_t marks;
+
+	//values of the marked positions, in string order
+	spsi<packed_vector,256,16> mark_values;
+
 };
 
 }
@@ -320,7 +320,7 @@ public:
 
 	}
 
-	ulint serialize(ostream &out){
+	ulint serialize(ostream &out) const {
 
 		ulint w_bytes=0;
 
@@ -130,8 +130,11 @@ class spsi {
    * move assignment
    */
   void operator=(spsi&& sp) {
-    root->free_mem();
-    delete root;
+    // root is NULL if this spsi has been moved from
+    if (root) {
+      root->free_mem();
+      delete root;
+    }
 
     root = sp.root;
     sp.root = NULL;
@@ -240,6 +243,61 @@ class spsi {
     insert_word(size(), x, width, n);
   }
 
+  /*
+   * push back n integers of the given width packed into words (64/width
+   * integers per word, as in packed_vector).
+   *
+   * Bulk path: if the structure is empty, leaves are cut directly from the
+   * words and the tree is built bottom-up in linear time. Otherwise, words
+   * are pushed one by one.
+   */
+  void push_words(const vector<uint64_t>& words, uint64_t n, uint8_t width) {
+    assert(width > 0 and width <= 64);
+
+    const uint64_t int_per_word = 64 / width;
+    assert(words.size() * int_per_word >= n);
+
+    if (n == 0) return;
+
+    if (size() > 0) {
+      for (uint64_t j = 0; j * int_per_word < n; ++j)
+        push_word(words[j], width, std::min<uint64_t>(int_per_word, n - j * int_per_word));
+
+      return;
+    }
+
+    // leaves are filled to 3/2 of their minimum size, leaving room for inserts
+    const uint64_t words_per_leaf = std::max<uint64_t>(1, (3 * B_LEAF / 2) / int_per_word);
+    const uint64_t tot_words = n / int_per_word + (n % int_per_word != 0);
+
+    vector<node*> level;
+    vector<leaf_type*> leaves;
+
+    for (uint64_t w = 0; w < tot_words; w += words_per_leaf) {
+      uint64_t end = std::min(tot_words, w + words_per_leaf);
+      uint64_t len = std::min(n, end * int_per_word) - w * int_per_word;
+
+      vector<uint64_t> leaf_words(words.begin() + w, words.begin() + end);
+
+      // clear unused bits of the last word
+      if (len % int_per_word) leaf_words.back() &= (uint64_t(1) << ((len % int_per_word) * width)) - 1;
+
+      leaves.push_back(new leaf_type(std::move(leaf_words), len, width));
+    }
+
+    for (auto& group : groups(leaves)) level.push_back(new node(std::move(group)));
+
+    while (level.size() > 1) {
+      vector<node*> next;
+      for (auto& group : groups(level)) next.push_back(new node(std::move(group)));
+      level = std::move(next);
+    }
+
+    root->free_mem();
+    delete root;
+    root = level[0];
+  }
+
   /*
    * insert a new integer x at position i
    */
@@ -352,6 +410,28 @@ class spsi {
 
  private:
   class node;
+
+  /*
+   * split a sequence of children into groups of almost equal size (at most
+   * 3B/2+1 elements each), to be used as children of new internal nodes
+   */
+  template <class T>
+  static vector<vector<T*>> groups(const vector<T*>& v) {
+    const uint64_t max_group = 3 * B / 2 + 1;
+    const uint64_t nr_groups = v.size() / max_group + (v.size() % max_group != 0);
+
+    vector<vector<T*>> res(nr_groups);
+
+    uint64_t j = 0;
+    for (uint64_t g = 0; g < nr_groups; ++g) {
+      uint64_t len = v.size() / nr_groups + (g < v.size() % nr_groups);
+      res[g] = vector<T*>(v.begin() + j, v.begin() + j + len);
+      j += len;
+    }
+
+    return res;
+  }
+
   node* root = NULL;  // tree root
 };
 
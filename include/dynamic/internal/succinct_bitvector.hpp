@@ -205,6 +205,17 @@ namespace dyn{
 
       }
 
+      /*
+       * push back the first n bits of the vector of words (bit j is bit j%64
+       * of word j/64). On an empty bitvector this builds the structure
+       * bottom-up in linear time.
+       */
+      void push_words(const vector<uint64_t>& words, uint64_t n){
+
+          spsi_.push_words(words, n, 1);
+
+      }
+
       /*
        * insert a bit not set at position i
        */
@@ -12,11 +12,24 @@
  *  Dynamic string supporting rank, select, access, insert.
  *  Backed by a wavelet matrix based on the templated dynamic bitvector.
  *
+ *  - wm_string(sigma) : fixed-length codes of log2(sigma) bits.
+ *  - wm_string(vector<pair<ulint,double> > P) : Huffman-shaped wavelet matrix.
+ *    Symbol c is stored with a code of (Huffman) length len(c) and crosses only
+ *    the first len(c) levels: space is about n(H0+1) bits and the average cost
+ *    of access/rank/select/insert/remove is proportional to H0. Codes are
+ *    assigned level by level so that, at each level, the symbols whose codes
+ *    end there are the last ones in the wavelet matrix order of the next level.
+ *    The standard wavelet matrix navigation therefore works unchanged: level
+ *    i+1 is just shorter than level i. The alphabet is fixed at construction.
+ *
  */
 
 #ifndef INCLUDE_INTERNAL_WM_STRING_HPP_
 #define INCLUDE_INTERNAL_WM_STRING_HPP_
 
+#include <queue>
+#include <tuple>
+
 #include "dynamic/internal/includes.hpp"
 
 namespace dyn{
@@ -50,30 +63,68 @@ public:
         }
     }
 
-    // hack to accept an alphabet with frequencies, to match wt_string interface for testing
-    // doesn't work
     /*
-    wm_string(vector<pair<ulint, double>>& P) {
-        n = 0;
-        sigma = 0;
+     * Huffman-shaped wavelet matrix. Input: pairs <character, probability>.
+     *
+     * Note: all characters that will appear in the text must be included
+     * in P. If in doubt, assign probability 0 (such characters will get
+     * the longest codes)
+     */
+    wm_string(vector<pair<ulint, double>>& P) : n(0), sigma(0), huffman(true) {
+        assert(P.size() > 0);
+
         for (auto& e : P) {
-            if (e.first > sigma) {
-                sigma = e.first;
+            if (e.first >= sigma) {
+                sigma = e.first + 1;
             }
         }
-        ++sigma;
-        this->bit_width = this->get_num_of_bit(sigma-1);
-        if (bit_width == 0) {
-            bit_width = 1;
+
+        vector<ulint> len = huffman_lengths(P);
+
+        // a single character still needs one bit
+        for (auto& l : len) {
+            l = std::max<ulint>(l, 1);
+            bit_width = std::max(bit_width, l);
         }
-        this->begin_one.resize(bit_width);
 
-        for (ulint i = 0; i < bit_width; ++i) {
-            dynamic_bitvector_t sv;
-            bit_arrays.push_back(sv);
+        assert(bit_width <= 64);
+
+        code_len.assign(sigma, 0);
+        codes.assign(sigma, 0);
+        decode_.resize(bit_width + 1);
+
+        // characters grouped by code length
+        vector<vector<ulint>> by_len(bit_width + 1);
+        for (ulint j = 0; j < P.size(); ++j) {
+            by_len[len[j]].push_back(P[j].first);
         }
+
+        // nodes of the current level, in wavelet matrix order. The children of
+        // the nodes at level d appear at level d+1 in this order: all 0-children,
+        // then all 1-children (stable). Leaves take the last positions.
+        vector<ulint> nodes = {0};
+        for (ulint d = 1; d <= bit_width; ++d) {
+            vector<ulint> next;
+            for (auto x : nodes) next.push_back(x << 1);
+            for (auto x : nodes) next.push_back((x << 1) | 1);
+
+            ulint k = by_len[d].size();
+            assert(k <= next.size());
+
+            for (ulint j = 0; j < k; ++j) {
+                ulint c = by_len[d][j];
+                codes[c] = next[next.size() - k + j];
+                code_len[c] = d;
+                decode_[d][codes[c]] = c;
+            }
+
+            next.resize(next.size() - k);
+            nodes = next;
+        }
+
+        this->begin_one.resize(bit_width);
+        bit_arrays.resize(bit_width);
     }
-    */
 
     wm_string (ulint num_of_alphabet, const std::vector<ulint> &array) : n(0), sigma(num_of_alphabet + 1) {
         this->bit_width = this->get_num_of_bit(num_of_alphabet);
@@ -91,38 +142,50 @@ public:
         }
 
         n = array.size();
+        bit_arrays.resize(bit_width);
 
-        std::vector<ulint> v(array), b(array.size(), 0);
+        // level i: the i-th most significant bits of v go into a word buffer,
+        // then a stable counting sort of v on that bit gives the order of
+        // level i+1. Each buffer is loaded with the bitvector bulk path in a
+        // separate task, overlapped with the construction of the next levels.
+        std::vector<ulint> v(array), next(array.size());
+        std::vector<std::vector<uint64_t>> words(bit_width);
 
-        for (ulint i = 0; i < bit_width; ++i) {
+        #pragma omp parallel
+        #pragma omp master
+        {
+            for (ulint i = 0; i < bit_width; ++i) {
+                words[i].assign(n / 64 + 1, 0);
 
-            std::vector<ulint> temp;
-            // 0をtempにいれてく
-            for (ulint j = 0; j < v.size(); ++j) {
-                ulint c = v.at(j);
-                ulint bit = (c >> (bit_width - i - 1)) & 1;  //　上からi番目のbit
-                if (bit == 0) {
-                    temp.push_back(c);
-                    b[j] = 0;
+                ulint zeros = 0;
+                for (ulint j = 0; j < n; ++j) {
+                    const uint64_t bit = (v[j] >> (bit_width - i - 1)) & 1;  //　上からi番目のbit
+                    words[i][j / 64] |= bit << (j % 64);
+                    zeros += 1 - bit;
                 }
-            }
 
-            this->begin_one.at(i) = temp.size();
+                this->begin_one.at(i) = zeros;
+
+                if (i + 1 < bit_width) {
+                    ulint z = 0, o = zeros;
+                    for (ulint j = 0; j < n; ++j) {
+                        if ((words[i][j / 64] >> (j % 64)) & 1) {
+                            next[o++] = v[j];
+                        } else {
+                            next[z++] = v[j];
+                        }
+                    }
+                    v.swap(next);
+                }
 
-            // 1をtempにいれてく
-            for (ulint j = 0; j < v.size(); ++j) {
-                ulint c = v.at(j);
-                ulint bit = (c >> (bit_width - i - 1)) & 1;  //　上からi番目のbit
-                if (bit == 1) {
-                    temp.push_back(c);
-                    b[j] = 1;
+                #pragma omp task shared(words)
+                {
+                    bit_arrays[i].push_words(words[i], n);
+                    std::vector<uint64_t>().swap(words[i]);
                 }
             }
 
-            dynamic_bitvector_t dbv;
-            for (auto& i : b) { dbv.push_back(i); }
-            bit_arrays.emplace_back(dbv);
-            v = temp;
+            #pragma omp taskwait
         }
     }
 
@@ -139,6 +202,14 @@ public:
         for (auto& bv : bit_arrays) {
             w_bytes += bv.serialize(out);
         }
+        out.write((char*)&huffman, sizeof(huffman));
+        w_bytes += sizeof(huffman);
+        if (huffman) {
+            out.write((char*)code_len.data(), sizeof(uint8_t) * sigma);
+            w_bytes += sizeof(uint8_t) * sigma;
+            out.write((char*)codes.data(), sizeof(ulint) * sigma);
+            w_bytes += sizeof(ulint) * sigma;
+        }
         return w_bytes;
     }
 
@@ -152,6 +223,20 @@ public:
         for (ulint i = 0; i < bit_width; ++i) {
             bit_arrays[i].load(in);
         }
+        in.read((char*)&huffman, sizeof(huffman));
+        code_len.clear();
+        codes.clear();
+        decode_.clear();
+        if (huffman) {
+            code_len.resize(sigma);
+            codes.resize(sigma);
+            in.read((char*)code_len.data(), sizeof(uint8_t) * sigma);
+            in.read((char*)codes.data(), sizeof(ulint) * sigma);
+            decode_.resize(bit_width + 1);
+            for (ulint c = 0; c < sigma; ++c) {
+                if (code_len[c]) decode_[code_len[c]][codes[c]] = c;
+            }
+        }
     }
 
     // v[pos]
@@ -162,6 +247,11 @@ public:
         for (ulint i = 0; i < bit_arrays.size(); ++i) {
             ulint bit = bit_arrays.at(i).at(pos);   // もとの数値がのi番目のbit
             c = (c <<= 1) | bit;
+            if (huffman) {
+                // the code may end at this level
+                auto it = decode_[i + 1].find(c);
+                if (it != decode_[i + 1].end()) return it->second;
+            }
             pos = bit_arrays.at(i).rank(pos, bit);
             if (bit) {
                 pos += this->begin_one.at(i);
@@ -176,13 +266,14 @@ public:
     // v[0, pos)のcの数
     ulint rank(ulint pos, ulint c) const {
         assert(pos <= n);
-        if (c >= sigma) {
+        if (c >= sigma or code_length(c) == 0) {
             return 0;
         }
 
+        const ulint code = code_of(c), len = code_length(c);
         ulint left = 0, right = pos;
-        for (ulint i = 0; i < bit_width; ++i) {
-            const ulint bit = (c >> (bit_width - i - 1)) & 1;  // 上からi番目のbit
+        for (ulint i = 0; i < len; ++i) {
+            const ulint bit = (code >> (len - i - 1)) & 1;  // 上からi番目のbit
             left = bit_arrays.at(i).rank(left, bit);             // cのi番目のbitと同じ数値の数
             right = bit_arrays.at(i).rank(right, bit);           // cのi番目のbitと同じ数値の数
             if (bit) {
@@ -200,9 +291,12 @@ public:
         assert(c < sigma);
         --rank;
 
+        const ulint code = code_of(c), len = code_length(c);
+        assert(len > 0);
+
         ulint left = 0;
-        for (ulint i = 0; i < bit_width; ++i) {
-            const ulint bit = (c >> (bit_width - i - 1)) & 1;  // 上からi番目のbit
+        for (ulint i = 0; i < len; ++i) {
+            const ulint bit = (code >> (len - i - 1)) & 1;  // 上からi番目のbit
             left = bit_arrays.at(i).rank(left, bit);               // cのi番目のbitと同じ数値の数
             if (bit) {
                 left += this->begin_one.at(i);
@@ -210,13 +304,13 @@ public:
         }
 
         ulint index = left + rank;
-        for (ulint i = 0; i < bit_arrays.size(); ++i){
-            ulint bit = ((c >> i) & 1);      // 下からi番目のbit
+        for (ulint i = 0; i < len; ++i){
+            ulint bit = ((code >> i) & 1);      // 下からi番目のbit
             if (bit == 1) {
-                index -= this->begin_one.at(bit_width - i - 1);
+                index -= this->begin_one.at(len - i - 1);
             }
             //std::cerr << "selecting index " << index << " bit " << bit << std::endl;
-            index = this->bit_arrays.at(bit_width - i - 1).select(index, bit);
+            index = this->bit_arrays.at(len - i - 1).select(index, bit);
         }
         return index+1;
     }
@@ -224,9 +318,11 @@ public:
     // posにcを挿入する
     void insert(ulint pos, ulint c) {
         assert(pos <= this->n);
+        assert(c < sigma and code_length(c) > 0);
 
-        for (ulint i = 0; i < bit_arrays.size(); ++i) {
-            const ulint bit = (c >> (bit_width - i - 1)) & 1;  //　上からi番目のbit
+        const ulint code = code_of(c), len = code_length(c);
+        for (ulint i = 0; i < len; ++i) {
+            const ulint bit = (code >> (len - i - 1)) & 1;  //　上からi番目のbit
             bit_arrays.at(i).insert(pos, bit);
             pos = bit_arrays.at(i).rank(pos, bit);
             if (bit) {
@@ -240,6 +336,25 @@ public:
         this->n++;
     }
 
+    /*
+     * double the alphabet (fixed-length codes only). Codes get one more
+     * (most significant) bit, equal to 0 for the characters already in the
+     * string: the new top level is all zeros and, since a stable partition
+     * of all zeros keeps the order, the other levels are unchanged.
+     */
+    void add_level() {
+        assert(not huffman);
+
+        dynamic_bitvector_t top;
+        if (this->n > 0) top.push_words(std::vector<uint64_t>((this->n + 63) / 64, 0), this->n);
+
+        this->bit_arrays.insert(this->bit_arrays.begin(), std::move(top));
+        this->begin_one.insert(this->begin_one.begin(), this->n);
+
+        this->bit_width++;
+        this->sigma = bit_width >= 64 ? ~ulint(0) : ulint(1) << bit_width;
+    }
+
     void push_front(ulint c) {
         this->insert(0, c);
     }
@@ -249,6 +364,79 @@ public:
         this->insert(this->n, c);
     }
 
+    /*
+     * distinct characters in v[l, r), with their number of occurrences in
+     * v[l, r), in increasing order of code. Subtrees with empty ranges are
+     * not visited: cost is O(bit_width) rank operations per distinct character
+     */
+    std::vector<std::pair<ulint, ulint>> range_distinct(ulint l, ulint r) const {
+        assert(l <= r and r <= n);
+
+        std::vector<std::pair<ulint, ulint>> res;
+
+        // <level, code, range at that level>
+        std::vector<std::tuple<ulint, ulint, ulint, ulint>> stack;
+        if (r > l) stack.emplace_back(0, 0, l, r);
+
+        while (not stack.empty()) {
+            ulint i, code, b, e;
+            std::tie(i, code, b, e) = stack.back();
+            stack.pop_back();
+
+            ulint c;
+            if (is_leaf(i, code, c)) {
+                res.push_back({c, e - b});
+                continue;
+            }
+
+            // ones are pushed first so that zeros are visited first
+            std::pair<ulint, ulint> zeros, ones;
+            children(i, b, e, zeros, ones);
+
+            if (ones.second > ones.first) stack.emplace_back(i + 1, (code << 1) | 1, ones.first, ones.second);
+            if (zeros.second > zeros.first) stack.emplace_back(i + 1, code << 1, zeros.first, zeros.second);
+        }
+
+        return res;
+    }
+
+    /*
+     * the (at most) k most frequent characters in v[l, r), with their number
+     * of occurrences in v[l, r), in decreasing order of frequency. Nodes are
+     * expanded greedily by decreasing range size, so only the subtrees that
+     * can contain one of the k answers are visited
+     */
+    std::vector<std::pair<ulint, ulint>> range_top_k(ulint l, ulint r, ulint k) const {
+        assert(l <= r and r <= n);
+
+        std::vector<std::pair<ulint, ulint>> res;
+
+        // <range size, level, code, begin of the range at that level>
+        typedef std::tuple<ulint, ulint, ulint, ulint> item;
+        std::priority_queue<item> pq;
+        if (r > l) pq.emplace(r - l, 0, 0, l);
+
+        while (not pq.empty() and res.size() < k) {
+            ulint size, i, code, b;
+            std::tie(size, i, code, b) = pq.top();
+            pq.pop();
+
+            ulint c;
+            if (is_leaf(i, code, c)) {
+                res.push_back({c, size});
+                continue;
+            }
+
+            std::pair<ulint, ulint> zeros, ones;
+            children(i, b, b + size, zeros, ones);
+
+            if (zeros.second > zeros.first) pq.emplace(zeros.second - zeros.first, i + 1, code << 1, zeros.first);
+            if (ones.second > ones.first) pq.emplace(ones.second - ones.first, i + 1, (code << 1) | 1, ones.first);
+        }
+
+        return res;
+    }
+
     // posを削除する
     void remove(ulint pos) {
         assert(pos < this->n);
@@ -256,8 +444,10 @@ public:
             throw "Segmentation fault";
         }
 
+        ulint code = 0;
         for (ulint i = 0; i < bit_arrays.size(); ++i) {
             ulint bit = bit_arrays.at(i).at(pos);   // もとの数値のi番目のbit
+            code = (code << 1) | bit;
 
             auto next_pos = bit_arrays.at(i).rank(pos, bit);
             bit_arrays.at(i).remove(pos);
@@ -269,6 +459,11 @@ public:
                 this->begin_one.at(i)--;
             }
             pos = next_pos;
+
+            // the code ends at this level
+            if (huffman and decode_[i + 1].count(code)) {
+                break;
+            }
         }
         this->n--;
     }
@@ -290,12 +485,84 @@ public:
             n_bits += ba.bit_size();
         }
         n_bits += sizeof(ulint) * begin_one.size();
+        n_bits += (sizeof(uint8_t) + 3 * sizeof(ulint)) * codes.size() * 8;
         return n_bits;
     }
 
     // 他の操作は通常のWavelet Matrixと同じ
 
 private:
+    // Huffman-shaped matrix: code and code length of each character, and
+    // code -> character maps (one per code length)
+    bool huffman = false;
+    std::vector<uint8_t> code_len;
+    std::vector<ulint> codes;
+    std::vector<tsl::hopscotch_map<ulint, ulint>> decode_;
+
+    /*
+     * is the node with the given code (of length i) a leaf? If so, c is its character
+     */
+    bool is_leaf(ulint i, ulint code, ulint& c) const {
+        if (huffman) {
+            if (i == 0) return false;
+            auto it = decode_[i].find(code);
+            if (it == decode_[i].end()) return false;
+            c = it->second;
+            return true;
+        }
+        c = code;
+        return i == bit_width;
+    }
+
+    /*
+     * ranges at level i+1 of the 0-child and of the 1-child of range [b, e) at level i
+     */
+    void children(ulint i, ulint b, ulint e, std::pair<ulint, ulint>& zeros, std::pair<ulint, ulint>& ones) const {
+        const ulint b0 = bit_arrays.at(i).rank(b, 0), e0 = bit_arrays.at(i).rank(e, 0);
+        zeros = {b0, e0};
+        ones = {begin_one.at(i) + (b - b0), begin_one.at(i) + (e - e0)};
+    }
+
+    ulint code_of(ulint c) const {
+        return huffman ? codes[c] : c;
+    }
+
+    ulint code_length(ulint c) const {
+        return huffman ? code_len[c] : bit_width;
+    }
+
+    /*
+     * Huffman code lengths of the characters in P (same order)
+     */
+    static vector<ulint> huffman_lengths(const vector<pair<ulint, double>>& P) {
+        ulint m = P.size();
+
+        // tree nodes: 0..m-1 are the leaves
+        vector<ulint> parent(2 * m - 1, 0);
+
+        typedef pair<double, ulint> item;
+        priority_queue<item, vector<item>, greater<item>> pq;
+        for (ulint j = 0; j < m; ++j) {
+            pq.push({P[j].second, j});
+        }
+
+        ulint next = m;
+        while (pq.size() > 1) {
+            item x = pq.top(); pq.pop();
+            item y = pq.top(); pq.pop();
+            parent[x.second] = parent[y.second] = next;
+            pq.push({x.first + y.first, next++});
+        }
+
+        // the root is node 2m-2: depths are computed top-down
+        vector<ulint> depth(2 * m - 1, 0);
+        for (ulint j = 2 * m - 1; j-- > 0;) {
+            if (j != 2 * m - 2) depth[j] = depth[parent[j]] + 1;
+        }
+
+        return vector<ulint>(depth.begin(), depth.begin() + m);
+    }
+
     ulint get_num_of_bit(ulint x) {
         if (x == 0) return 0;
         x--;
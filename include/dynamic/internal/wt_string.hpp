@@ -19,11 +19,18 @@
  *  - dynamic_string(vector<pair<char_type,double> > P) : Huffman-encoding. The
  * characters set is fixed at construction time.
  *
+ *  With any constructor, set_reencoding_threshold() enables an online mode:
+ *  character frequencies are tracked and, when the code becomes too far from
+ *  a Huffman code for the current frequencies, the tree is rebuilt with
+ *  Huffman codes (see reencode()).
+ *
  */
 
 #ifndef INCLUDE_INTERNAL_WT_STRING_HPP_
 #define INCLUDE_INTERNAL_WT_STRING_HPP_
 
+#include <queue>
+
 #include "dynamic/internal/alphabet_encoder.hpp"
 #include "dynamic/internal/includes.hpp"
 
@@ -61,10 +68,14 @@ class wt_string {
    *
    * We know character probabilities. Input: pairs <character, probability>
    *
-   * Here the alphabet is Huffman encoded.
+   * Here the alphabet is Huffman encoded. Codes are no longer than
+   * max_code_len bits, which bounds the height of the tree.
    *
    */
-  explicit wt_string(vector<pair<char_type, double>>& P) { ae = alphabet_encoder(P); }
+  explicit wt_string(vector<pair<char_type, double>>& P,
+                     uint8_t max_code_len = alphabet_encoder::MAX_CODE_LEN) {
+    ae = alphabet_encoder(P, false, max_code_len);
+  }
 
   template <typename t_str>
   wt_string(uint64_t sigma, const t_str& str) : wt_string(sigma) { push_many(str); }
@@ -130,6 +141,20 @@ class wt_string {
     return root.exists(code) ? root.rank(i, code) : 0;
   }
 
+  /*
+   * distinct characters in positions [l, r), with their number of
+   * occurrences in [l, r), in no particular order. Only subtrees with
+   * non-empty ranges are visited
+   */
+  vector<pair<char_type, ulint>> range_distinct(uint64_t l, uint64_t r) const {
+    assert(l <= r and r <= size());
+
+    vector<pair<char_type, ulint>> res;
+    if (r > l) root.range_distinct(l, r, res);
+
+    return res;
+  }
+
   bool char_exists(char_type c) const { return ae.char_exists(c); }
 
   void push_back(char_type c) { insert(size(), c); }
@@ -137,18 +162,12 @@ class wt_string {
   // insert values from range [0,...,sigma)
   template <class Vector>
   void push_many(uint64_t sigma, const Vector& values) {
-    map<char_type, vector<bool>> path_to_leaf;
-    for (ulint c = 0; c < sigma; ++c) {
-      path_to_leaf[c] = ae.encode(c);
-    }
+    for (ulint c = 0; c < sigma; ++c) ae.encode(c);
 
     assert(std::all_of(values.begin(), values.end(),
                        [&](typename Vector::value_type c) { return ae.char_exists(c); }));
 
-    #pragma omp parallel
-    #pragma omp master
-    root.push_many(path_to_leaf, values);
-    n += values.size();
+    bulk_push(values);
   }
 
   template <class Vector>
@@ -158,15 +177,7 @@ class wt_string {
       if (!ae.char_exists(c)) ae.encode(c);
     }
 
-    map<char_type, vector<bool>> path_to_leaf;
-    for (char_type c : ae.keys()) {
-      path_to_leaf[c] = ae.encode(c);
-    }
-
-    #pragma omp parallel
-    #pragma omp master
-    root.push_many(path_to_leaf, values);
-    n += values.size();
+    bulk_push(values);
   }
 
   void push_front(char_type c) { insert(0, c); }
@@ -182,6 +193,11 @@ class wt_string {
     root.insert(i, code, c);
 
     ++n;
+
+    if (reencode_gap_ > 0) {
+      ++freq_[c];
+      if (n >= next_check_) check_reencode();
+    }
   }
 
   /*
@@ -194,6 +210,62 @@ class wt_string {
 
     root.remove(i, code, c);
     --n;
+
+    if (reencode_gap_ > 0) --freq_[c];
+  }
+
+  /*
+   * Adaptive re-encoding. If gap > 0, character frequencies are tracked and,
+   * every time the string has grown by 1/4 since the last check, the average
+   * code length is compared with that of a Huffman code for the current
+   * frequencies. If they differ by more than gap bits per character, the
+   * string is re-encoded (see reencode()). gap = 0 disables the mechanism.
+   *
+   * Frequencies are not serialized: call this again after load().
+   */
+  void set_reencoding_threshold(double gap) {
+    assert(gap >= 0);
+
+    reencode_gap_ = gap;
+    freq_.clear();
+
+    if (gap > 0) {
+      if (n > 0) root.count_chars(freq_, n);
+      next_check_ = n + reencode_step();
+    }
+  }
+
+  /*
+   * rebuild the tree with Huffman codes computed on the current character
+   * frequencies. The codes stay open to new characters (escape code followed
+   * by a gamma code). The string is extracted (subtrees in parallel) and
+   * rebuilt with the bulk construction of push_many.
+   */
+  void reencode() {
+    if (n == 0) return;
+
+    tsl::hopscotch_map<char_type, ulint> freq;
+    if (reencode_gap_ > 0)
+      freq = freq_;
+    else
+      root.count_chars(freq, n);
+
+    vector<pair<char_type, double>> P;
+    for (auto e : freq)
+      if (e.second > 0) P.push_back({e.first, double(e.second) / n});
+
+    vector<char_type> S;
+
+    #pragma omp parallel
+    #pragma omp master
+    root.extract(n, S);
+
+    wt_string tmp;
+    tmp.ae = alphabet_encoder(P, true);
+    tmp.push_many(S);
+
+    root = std::move(tmp.root);
+    ae = std::move(tmp.ae);
   }
 
   uint64_t bit_size() const {
@@ -228,12 +300,107 @@ class wt_string {
  private:
   class node;
 
+  /*
+   * append values (all characters must already have a code). Characters are
+   * mapped to dense 32-bit ids; each node then distributes its ids to the
+   * children with a stable counting sort on one code bit and loads its bits
+   * with the bitvector bulk path. Subtrees are built in parallel (OpenMP tasks).
+   * Time is linear in the total length of the codes.
+   */
+  template <class Vector>
+  void bulk_push(const Vector& values) {
+    tsl::hopscotch_map<char_type, uint32_t> id;
+    vector<const vector<bool>*> codes;
+    vector<char_type> labels;
+
+    vector<uint32_t> ids(values.size());
+
+    for (ulint i = 0; i < values.size(); ++i) {
+      char_type c = values[i];
+      auto it = id.find(c);
+
+      if (it == id.end()) {
+        assert(codes.size() < ~uint32_t(0));
+        it = id.insert({c, uint32_t(codes.size())}).first;
+        codes.push_back(&ae.encode_existing(c));
+        labels.push_back(c);
+      }
+
+      ids[i] = it->second;
+    }
+
+    #pragma omp parallel
+    #pragma omp master
+    root.push_many(std::move(ids), codes, labels);
+
+    n += values.size();
+
+    if (reencode_gap_ > 0) {
+      for (ulint i = 0; i < values.size(); ++i) ++freq_[values[i]];
+      if (n >= next_check_) check_reencode();
+    }
+  }
+
+  // minimum number of insertions between two re-encoding checks
+  static const ulint REENCODE_MIN_STEP = 4096;
+
+  ulint reencode_step() const { return n / 4 > REENCODE_MIN_STEP ? n / 4 : REENCODE_MIN_STEP; }
+
+  /*
+   * re-encode if the current codes waste more than reencode_gap_ bits per
+   * character with respect to a Huffman code
+   */
+  void check_reencode() {
+    next_check_ = n + reencode_step();
+
+    ulint cur_bits = 0;
+    vector<ulint> f;
+
+    for (auto e : freq_) {
+      if (e.second == 0) continue;
+      cur_bits += e.second * ae.encode_existing(e.first).size();
+      f.push_back(e.second);
+    }
+
+    if (double(cur_bits - huffman_bits(f)) / n > reencode_gap_) {
+      reencode();
+      next_check_ = n + reencode_step();
+    }
+  }
+
+  /*
+   * total bit-length of a Huffman encoding of a text with these
+   * character frequencies
+   */
+  static ulint huffman_bits(const vector<ulint>& f) {
+    if (f.size() == 1) return f[0];
+
+    priority_queue<ulint, vector<ulint>, greater<ulint>> pq(f.begin(), f.end());
+
+    ulint bits = 0;
+    while (pq.size() > 1) {
+      ulint x = pq.top();
+      pq.pop();
+      x += pq.top();
+      pq.pop();
+      bits += x;
+      pq.push(x);
+    }
+
+    return bits;
+  }
+
   // current length
   ulint n = 0;
 
   node root;
 
   alphabet_encoder ae;
+
+  // adaptive re-encoding (disabled if reencode_gap_ == 0)
+  double reencode_gap_ = 0;
+  ulint next_check_ = 0;
+  tsl::hopscotch_map<char_type, ulint> freq_;
 };
 
 template <class dynamic_bitvector_t>
@@ -417,82 +584,74 @@ class wt_string<dynamic_bitvector_t>::node {
     }
   }
 
-  template <class Vector>
-  void push_many(const map<char_type, vector<bool>>& Bs, const Vector& values,
-                 ulint j = 0, ulint offset = 0) {
-    if (Bs.size() == 1) {
+  /*
+   * append the characters with the given ids (see wt_string::bulk_push) at
+   * the end of this subtree. codes[id] and labels[id] are the code and the
+   * character associated with id; j is the depth of this node.
+   */
+  void push_many(vector<uint32_t>&& ids, const vector<const vector<bool>*>& codes,
+                 const vector<char_type>& labels, ulint j = 0) {
+    if (ids.size() == 0) return;
+
+    // codes are prefix-free: if one code ends here, this node is its leaf
+    if (j == codes[ids[0]]->size()) {
       // this node must be a leaf
       assert(bv.size() == 0);
 
-      auto c = Bs.begin()->first;
-      assert(j == Bs.at(c).size());
-
       if (is_leaf()) {
         // if it's already marked as leaf, check
         // that the label is correct
-        assert(c == label());
+        assert(labels[ids[0]] == label());
       } else {
         // else, mark node as leaf
-        make_leaf(c);
+        make_leaf(labels[ids[0]]);
       }
       return;
     }
 
     assert(not is_leaf());
 
-    bool task_started_0 = false;
-    bool task_started_1 = false;
-
-    tsl::hopscotch_map<char_type, bool> assignment;
-    map<char_type, vector<bool>> Bs_left, Bs_right;
-    for_each(Bs.begin(), Bs.end(),
-             [&](const pair<char_type, vector<bool>>& pair) {
-               if (pair.second[j]) {
-                 Bs_right.insert(pair);
-               } else {
-                 Bs_left.insert(pair);
-               }
-               assignment[pair.first] = pair.second[j];
-             });
-
-    uint64_t word = 0;
-    uint8_t num_bits = 0;
-
-    for (ulint idx = offset; idx < values.size(); ++idx) {
-      char_type c = values[idx];
-      auto it = assignment.find(c);
-      if (it == assignment.end()) continue;
-
-      uint64_t b = it->second;
-
-      word |= b << num_bits;
-
-      if (++num_bits == 64) {
-        bv.push_word(word, 64);
-        word = 0;
-        num_bits = 0;
-      }
+    const ulint size = ids.size();
 
-      if (b && !task_started_1) {
-        task_started_1 = true;
+    // bits of this node, and stable counting sort of the ids on them
+    vector<uint64_t> words(size / 64 + 1, 0);
+    ulint n1 = 0;
 
-        if (not has_child1()) child1_ = new node(this);
+    for (ulint k = 0; k < size; ++k) {
+      uint64_t b = (*codes[ids[k]])[j];
+      words[k / 64] |= b << (k % 64);
+      n1 += b;
+    }
 
-        #pragma omp task shared(values, Bs_right)
-        child1_->push_many(Bs_right, values, j + 1, idx);
-      }
+    vector<uint32_t> ids0, ids1;
+    ids0.reserve(size - n1);
+    ids1.reserve(n1);
 
-      if (!b && !task_started_0) {
-        task_started_0 = true;
+    for (ulint k = 0; k < size; ++k) {
+      if ((words[k / 64] >> (k % 64)) & 1)
+        ids1.push_back(ids[k]);
+      else
+        ids0.push_back(ids[k]);
+    }
 
-        if (not has_child0()) child0_ = new node(this);
+    ids = vector<uint32_t>();
 
-        #pragma omp task shared(values, Bs_left)
-        child0_->push_many(Bs_left, values, j + 1, idx);
-      }
+    #pragma omp task shared(words)
+    bv.push_words(words, size);
+
+    if (ids1.size() > 0) {
+      if (not has_child1()) child1_ = new node(this);
+
+      #pragma omp task shared(ids1, codes, labels)
+      child1_->push_many(std::move(ids1), codes, labels, j + 1);
     }
 
-    if (num_bits) bv.push_word(word, num_bits);
+    if (ids0.size() > 0) {
+      if (not has_child0()) child0_ = new node(this);
+
+      #pragma omp task shared(ids0, codes, labels)
+      child0_->push_many(std::move(ids0), codes, labels, j + 1);
+    }
 
     #pragma omp taskwait
   }
@@ -591,6 +750,63 @@ class wt_string<dynamic_bitvector_t>::node {
                            );
   }
 
+  /*
+   * add to f the number of occurrences of each character in this subtree,
+   * which contains count characters
+   */
+  void count_chars(tsl::hopscotch_map<char_type, ulint>& f, ulint count) const {
+    if (is_leaf()) {
+      f[label()] += count;
+      return;
+    }
+
+    if (has_child0()) child0_->count_chars(f, bv.rank0(bv.size()));
+    if (has_child1()) child1_->count_chars(f, bv.rank1(bv.size()));
+  }
+
+  /*
+   * append to res the distinct characters in [l, r) (non-empty) of this
+   * subtree, with their number of occurrences
+   */
+  void range_distinct(ulint l, ulint r, vector<pair<char_type, ulint>>& res) const {
+    if (is_leaf()) {
+      res.push_back({label(), r - l});
+      return;
+    }
+
+    ulint l0 = bv.rank0(l), r0 = bv.rank0(r);
+
+    if (r0 > l0) child0_->range_distinct(l0, r0, res);
+    if (r - r0 > l - l0) child1_->range_distinct(l - l0, r - r0, res);
+  }
+
+  /*
+   * store in S the count characters of this subtree (in order)
+   */
+  void extract(ulint count, vector<char_type>& S) const {
+    if (is_leaf()) {
+      S = vector<char_type>(count, label());
+      return;
+    }
+
+    assert(count == bv.size());
+
+    vector<char_type> S0, S1;
+
+    #pragma omp task shared(S0) if (has_child0())
+    if (has_child0()) child0_->extract(bv.rank0(count), S0);
+
+    #pragma omp task shared(S1) if (has_child1())
+    if (has_child1()) child1_->extract(bv.rank1(count), S1);
+
+    #pragma omp taskwait
+
+    S = vector<char_type>(count);
+
+    ulint i0 = 0, i1 = 0;
+    for (ulint i = 0; i < count; ++i) S[i] = bv.at(i) ? S1[i1++] : S0[i0++];
+  }
+
   bool is_root() const { return not parent_; }
   bool is_leaf() const { return is_leaf_; }
   bool has_child0() const { return child0_; }
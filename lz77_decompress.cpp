@@ -0,0 +1,70 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * lz77_decompress.cpp
+ *
+ *  Decode a compact LZ77 file (varint, gamma or delta coding, see
+ *  dynamic/algorithms/lz77_format.hpp) written by rle_lz77_v1, rle_lz77_v2
+ *  or h0_lz77 with option -c. Blocks are entropy-decoded in parallel when
+ *  compiled with OpenMP (cmake option XXSDS_DYN_MULTI_THREADED).
+ *
+ */
+
+#include <chrono>
+#include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/lz77_format.hpp"
+
+using namespace std;
+using namespace dyn;
+
+int main(int argc,char** argv) {
+
+	using std::chrono::high_resolution_clock;
+	using std::chrono::duration_cast;
+	using std::chrono::duration;
+
+	if(argc!=3){
+
+		cout << "Decode a compact LZ77 file." << endl << endl;
+		cout << "Usage: lz77_decompress <input_file> <output_file> " << endl;
+		cout << "   input_file: LZ77 file written with a varint, gamma or delta coding" << endl;
+		cout << "   output_file: the decoded text will be saved in this file" << endl;
+
+		exit(0);
+
+	}
+
+	auto t1 = high_resolution_clock::now();
+
+	std::ifstream ifs(argv[1], ios::binary);
+
+	lz77_decoder dec(ifs);
+
+	if(not dec.is_valid()){
+
+		cout << "Error: " << argv[1] << " is not a compact LZ77 file." << endl;
+		exit(1);
+
+	}
+
+	cout << "Phrases: " << dec.number_of_phrases() << endl;
+	cout << "Blocks: " << dec.number_of_blocks() << endl;
+	cout << "Text length: " << dec.text_length() << endl;
+
+	std::ofstream os(argv[2], ios::binary);
+
+	dec.decompress(os);
+
+	ifs.close();
+	os.close();
+
+	auto t2 = high_resolution_clock::now();
+
+	uint64_t msec = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+	cout << endl << "done" << endl;
+	cout << " Total time: " << (double)msec/1000 << " seconds" << endl;
+
+}
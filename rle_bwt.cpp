@@ -13,6 +13,7 @@
 
 #include <chrono>
 #include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/parallel_bwt.hpp"
 
 using namespace std;
 using namespace dyn;
@@ -23,10 +24,21 @@ int main(int argc,char** argv) {
 	using std::chrono::duration_cast;
 	using std::chrono::duration;
 
-	if(argc!=3){
+	int ptr = 1;
+	ulint threads = 1;
+
+	if(argc==5 and string(argv[1]).compare("-p")==0){
+
+		threads = atol(argv[2]);
+		ptr = 3;
+
+	}
+
+	if(argc!=ptr+2 or threads==0){
 
 		cout << "Build the BWT of the reversed text with a dynamic run-length encoded BWT structure" << endl << endl;
-		cout << "Usage: rle_bwt <input_file> <output_file> " << endl;
+		cout << "Usage: rle_bwt [-p <threads>] <input_file> <output_file> " << endl;
+		cout << "   -p <threads>: build the BWT by chunks with <threads> threads (requires OpenMP, see parallel_bwt.hpp). default: 1." << endl;
 		cout << "   input_file: compute BWT of the reverse of this file" << endl;
 		cout << "   output_file: output BWT file" << endl;
 
@@ -36,8 +48,8 @@ int main(int argc,char** argv) {
 
 	auto t1 = high_resolution_clock::now();
 
-	string in(argv[1]);
-	string out(argv[2]);
+	string in(argv[ptr]);
+	string out(argv[ptr+1]);
 
 	rle_bwt bwt;
 
@@ -62,21 +74,33 @@ int main(int argc,char** argv) {
 	long int step = 1000000;	//print status every step characters
 	long int last_step = 0;
 
-	cout << "Building RLBWT ..." << endl;
+	if(threads > 1){
 
-	char c;
-	while(ifs.get(c)){
+		cout << "Building RLBWT with " << threads << " threads ..." << endl;
 
-		if(j>last_step+(step-1)){
+		build_bwt_by_chunks(bwt, in, threads, 0, true);
 
-			last_step = j;
-			cout << " " << j << " characters processed ..." << endl;
+	}else{
 
-		}
+		cout << "Building RLBWT ..." << endl;
+
+		input_reader reader(ifs);
 
-		bwt.extend( uchar(c) );
+		char c;
+		while(reader.get(c)){
 
-		j++;
+			if(j>last_step+(step-1)){
+
+				last_step = j;
+				cout << " " << j << " characters processed ..." << endl;
+
+			}
+
+			bwt.extend( uchar(c) );
+
+			j++;
+
+		}
 
 	}
 
@@ -84,9 +108,7 @@ int main(int argc,char** argv) {
 
 		auto cc = bwt[i];
 
-		c = cc == bwt.get_terminator() ? 0 : char(cc);
-
-		os.put(c);
+		os.put(cc == bwt.get_terminator() ? 0 : char(cc));
 
 	}
 
@@ -27,21 +27,100 @@
 using namespace std;
 using namespace dyn;
 
+lz77_coding coding = lz77_coding::raw;
+ulint checkpoint_rate = 0;
+bool resume = false;
+ulint symbol_bytes = 1;
+ulint skip = 15;
+ulint threads = 1;
+
+void help(){
+
+	cout << "Build LZ77 using a run-length encoded BWT with sparse SA sampling (2 samples per BWT run)." << endl << endl;
+	cout << "Usage: rle_lz77_v1 [options] <input_file> <output_file> " << endl;
+	cout << "Options: " << endl;
+	cout << "-k <skip>          after each phrase, skip 'skip' characters (LZ77 sparsification). default: 15." << endl;
+	cout << "                   Use -k 1 for the exact LZ77 parse." << endl;
+	cout << "-c <coding>        output coding: raw, varint, gamma or delta (see lz77_format.hpp). default: raw." << endl;
+	cout << "                   Sparsified parses (skip>1) can only be written raw." << endl;
+	cout << "-t <chars>         save a checkpoint to <output_file>.ckpt every <chars> input characters. default: no checkpoints." << endl;
+	cout << "-r                 resume from the checkpoint <output_file>.ckpt (use the same options and files of the interrupted run)." << endl;
+	cout << "-p <threads>       build the RLBWT by chunks with <threads> threads (requires OpenMP, see parallel_bwt.hpp). default: 1." << endl;
+	cout << "-b <bytes>         read the input as a stream of <bytes>-byte little-endian symbols (1, 2, 4 or 8). default: 1." << endl;
+	cout << "input_file: file to be parsed" << endl;
+	cout << "output_file: LZ77 triples <start,length,char> will be saved in binary format in this file" << endl;
+
+	exit(0);
+
+}
+
+void parse_args(char** argv, int argc, int &ptr){
+
+	assert(ptr<argc);
+
+	string s(argv[ptr]);
+	ptr++;
+
+	if(s.compare("-k")==0 and ptr<argc){
+
+		skip = atoi(argv[ptr++]);
+
+	}else if(s.compare("-c")==0 and ptr<argc){
+
+		if(not lz77_coding_from_string(argv[ptr++], coding)){
+			cout << "Error: unknown coding '" << argv[ptr-1] << "'." << endl;
+			help();
+		}
+
+	}else if(s.compare("-t")==0 and ptr<argc){
+
+		checkpoint_rate = atol(argv[ptr++]);
+
+	}else if(s.compare("-p")==0 and ptr<argc){
+
+		threads = atol(argv[ptr++]);
+
+	}else if(s.compare("-r")==0){
+
+		resume = true;
+
+	}else if(s.compare("-b")==0 and ptr<argc){
+
+		symbol_bytes = atol(argv[ptr++]);
+
+		if(symbol_bytes != 1 and symbol_bytes != 2 and symbol_bytes != 4 and symbol_bytes != 8){
+			cout << "Error: symbols must take 1, 2, 4 or 8 bytes." << endl;
+			help();
+		}
+
+	}else{
+		cout << "Error: unrecognized '" << s << "' option." << endl;
+		help();
+	}
+
+}
+
 int main(int argc,char** argv) {
 
 	using std::chrono::high_resolution_clock;
 	using std::chrono::duration_cast;
 	using std::chrono::duration;
 
-	if(argc!=3){
+	if(argc < 3) help();
 
-		cout << "Build LZ77 using a run-length encoded BWT with sparse SA sampling (2 samples per BWT run)." << endl << endl;
-		cout << "Usage: rle_lz7_v1 <input_file> <output_file> " << endl;
-		cout << "   input_file: file to be parsed" << endl;
-		cout << "   output_file: LZ77 triples <start,length,char> will be saved in text format in this file" << endl;
+	int ptr = 1;
 
-		exit(0);
+	while(ptr<argc-2)
+		parse_args(argv, argc, ptr);
 
+	if(threads == 0){
+		cout << "Error: the number of threads must be positive." << endl;
+		help();
+	}
+
+	if(skip == 0 or (skip > 1 and coding != lz77_coding::raw)){
+		cout << "Error: skip must be positive, and equal to 1 with non-raw codings." << endl;
+		help();
 	}
 
 	using lz77_t = rle_lz77_v1;
@@ -49,25 +128,50 @@ int main(int argc,char** argv) {
 	auto t1 = high_resolution_clock::now();
 
 	lz77_t lz77;
-	string in(argv[1]);
-	string out(argv[2]);
+	string in(argv[ptr]);
+	string out(argv[ptr+1]);
 
-	{
+	string ckpt = out + ".ckpt";
+
+	if(resume){
+
+		if(not std::ifstream(ckpt)){
+			cout << "Error: checkpoint " << ckpt << " not found." << endl;
+			exit(1);
+		}
+
+		cout << "Resuming from " << ckpt << endl;
+		lz77.resume(ckpt);
+
+	}else{
 
 		cout << "Detecting alphabet ... " << flush;
 		std::ifstream ifs(in);
 
-		lz77 = lz77_t(ifs);
+		lz77 = lz77_t(ifs, symbol_bytes);
 		ifs.close();
 
 		cout << "done." << endl;
 
 	}
 
+	lz77.set_checkpoint(ckpt, checkpoint_rate);
+
 	std::ifstream ifs(in);
-	std::ofstream os(out);
 
-	lz77.parse(ifs,os,15,true);
+	//when resuming, the output written before the checkpoint is kept
+	std::ofstream os(out, resume ? ios::binary | ios::in | ios::out : ios::binary);
+
+	{
+		lz77_encoder enc(os, coding, symbol_bytes);
+
+		//parse then finds the RLBWT already built
+		if(threads > 1) lz77.build_bwt(in,threads,true);
+
+		lz77.parse(ifs,enc,skip,true);
+
+		cout << "Output size: " << enc.bytes() << " Bytes" << endl;
+	}
 
 	ifs.close();
 	os.close();
@@ -0,0 +1,110 @@
+// Copyright (c) 2017, Nicola Prezza.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * rle_lz_end.cpp
+ *
+ *  Compute the LZ-End parsing in run-compressed space using a dynamic
+ *  run-length encoded BWT whose phrase ends are marked (see rle_lz_end.hpp).
+ *
+ *  Type of input text here is uchar
+ *
+ */
+
+#include <chrono>
+#include "dynamic/dynamic.hpp"
+#include "dynamic/algorithms/rle_lz_end.hpp"
+
+using namespace std;
+using namespace dyn;
+
+lz77_coding coding = lz77_coding::raw;
+
+void help(){
+
+	cout << "Build the LZ-End parse using a run-length encoded BWT with marked phrase ends." << endl << endl;
+	cout << "Usage: rle_lz_end [options] <input_file> <output_file> " << endl;
+	cout << "Options: " << endl;
+	cout << "-c <coding>        output coding: raw, varint, gamma or delta (see lz77_format.hpp). default: raw." << endl;
+	cout << "input_file: file to be parsed" << endl;
+	cout << "output_file: LZ-End phrases <start,length,char> will be saved in this file (LZ77 format: lz77_decompress decodes it)" << endl;
+
+	exit(0);
+
+}
+
+void parse_args(char** argv, int argc, int &ptr){
+
+	assert(ptr<argc);
+
+	string s(argv[ptr]);
+	ptr++;
+
+	if(s.compare("-c")==0 and ptr<argc){
+
+		if(not lz77_coding_from_string(argv[ptr++], coding)){
+			cout << "Error: unknown coding '" << argv[ptr-1] << "'." << endl;
+			help();
+		}
+
+	}else{
+		cout << "Error: unrecognized '" << s << "' option." << endl;
+		help();
+	}
+
+}
+
+int main(int argc,char** argv) {
+
+	using std::chrono::high_resolution_clock;
+	using std::chrono::duration_cast;
+	using std::chrono::duration;
+
+	if(argc < 3) help();
+
+	int ptr = 1;
+
+	while(ptr<argc-2)
+		parse_args(argv, argc, ptr);
+
+	auto t1 = high_resolution_clock::now();
+
+	string in(argv[ptr]);
+	string out(argv[ptr+1]);
+
+	cout << "Detecting alphabet ... " << flush;
+	std::ifstream ifs(in);
+
+	rle_lz_end lz_end(ifs);
+	ifs.close();
+
+	cout << "done." << endl;
+
+	ifs.open(in);
+	std::ofstream os(out, ios::binary);
+
+	{
+		lz77_encoder enc(os, coding);
+		lz_end.parse(ifs,enc,true);
+
+		cout << "Output size: " << enc.bytes() << " Bytes" << endl;
+	}
+
+	ifs.close();
+	os.close();
+
+	auto t2 = high_resolution_clock::now();
+
+	uint64_t sec = std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count();
+
+	ulint bitsize = lz_end.bit_size();
+
+	cout << endl << "done" << endl;
+	cout << " Total time: " << (double)sec << " seconds" << endl;
+	cout << " Size of the structures (bits): " << bitsize << endl;
+	cout << " Size of the structures (Bytes): " << bitsize/8 << endl;
+	cout << " Size of the structures (KB): " << (bitsize/8)/1024 << endl;
+	cout << " Size of the structures (MB): " << ((bitsize/8)/1024)/1024 << endl;
+
+}
@@ -403,6 +403,69 @@ bool test_serialize(uint64_t num, uint64_t num_of_alphabet) {
     return true;
 }
 
+// Huffman-shaped matrix: compare against a plain vector
+bool test_huffman(uint64_t num, uint64_t num_of_alphabet) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    // skewed distribution: character c has weight 1/(c+1)
+    vector<pair<uint64_t, double>> P;
+    vector<double> weights;
+    for (uint64_t c = 0; c < num_of_alphabet; ++c) {
+        P.push_back({c, 1.0 / (c + 1)});
+        weights.push_back(1.0 / (c + 1));
+    }
+    std::discrete_distribution<uint64_t> alpha_distrib(weights.begin(), weights.end());
+
+    dyn::wm_str actual(P);
+    vector<uint64_t> data;
+    for (int i = 0; i < num; ++i) {
+        std::uniform_int_distribution<uint64_t> pos_distrib(0, data.size());
+        uint64_t pos = pos_distrib(gen);
+        uint64_t c = alpha_distrib(gen);
+        data.insert(data.begin() + pos, c);
+        actual.insert(pos, c);
+    }
+
+    for (int i = 0; i < num / 2; ++i) {
+        std::uniform_int_distribution<uint64_t> pos_distrib(0, data.size()-1);
+        uint64_t pos = pos_distrib(gen);
+        uint64_t c = alpha_distrib(gen);
+        data[pos] = c;
+        actual.update(pos, c);
+    }
+
+    string f = "wm_string.test.temp";
+    ofstream out(f.c_str());
+    actual.serialize(out);
+    out.close();
+    dyn::wm_str loaded;
+    ifstream in(f.c_str());
+    loaded.load(in);
+    in.close();
+    std::remove(f.c_str());
+
+    vector<uint64_t> count(num_of_alphabet, 0);
+    for (int i = 0; i < data.size(); ++i) {
+        uint64_t c = data[i];
+        if (actual.at(i) != c or loaded.at(i) != c) {
+            cout << "Error at access: " << i << endl;
+            return false;
+        }
+        if (actual.rank(i, c) != count[c]) {
+            cout << "Error at rank: " << i << endl;
+            return false;
+        }
+        ++count[c];
+        if (actual.select(count[c], c) != i + 1) {
+            cout << "Error at select: " << i << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void speed_test(uint64_t num, uint64_t num_of_alphabet) {
     cout << "access:" << speed_access(num, num_of_alphabet) << "ms" << endl;
     cout << "rank:" << speed_rank(num, num_of_alphabet) << "ms" << endl;
@@ -421,6 +484,7 @@ bool test(uint64_t num, uint64_t num_of_alphabet) {
     ok &= test_remove(num, num_of_alphabet);
     ok &= test_update(num, num_of_alphabet);
     ok &= test_serialize(num, num_of_alphabet);
+    ok &= test_huffman(num, num_of_alphabet);
     return ok;
 }
 